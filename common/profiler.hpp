@@ -0,0 +1,296 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Scoped timers for the hot sections of a frame. A ProfileScope records
+// (name, start, duration) into a ring of the calling thread when it ends;
+// only that thread writes the ring, and readers copy it without locking, so
+// a scope costs two clock reads and a few relaxed stores. Names must be
+// string literals or otherwise outlive the program.
+//
+// Shared by conways_game_of_life and ml_classification_gui.
+struct ProfileSample {
+  const char* name;
+  int64_t start_ns;  // since Profiler::get() was first called
+  int64_t duration_ns;
+};
+
+class ProfileRing {
+ public:
+  static constexpr uint64_t kSize = 1 << 14;  // power of two
+
+  explicit ProfileRing(int id) : id(id) {}
+  void push(const char* name, int64_t start_ns, int64_t duration_ns);
+  // appends the samples that were not overwritten while being copied
+  void snapshot(std::vector<ProfileSample>&) const;
+
+  const int id;
+  std::string thread_name;  // written under Profiler's mutex
+
+ private:
+  struct Slot {
+    std::atomic<const char*> name{nullptr};
+    std::atomic<int64_t> start_ns{0};
+    std::atomic<int64_t> duration_ns{0};
+  };
+
+  Slot slots[kSize];
+  std::atomic<uint64_t> head{0};  // samples ever pushed
+};
+
+class Profiler {
+ public:
+  // sections whose percentiles are shown, over the samples of one window
+  struct Stats {
+    std::string name;
+    double p50_ms, p95_ms, p99_ms;
+    size_t count;
+  };
+
+  static Profiler& get();
+  int64_t now_ns() const;
+  void record(const char* name, int64_t start_ns, int64_t end_ns);
+  // labels the calling thread in traces
+  void name_thread(const std::string&);
+  // per section name, sorted by name
+  std::vector<Stats> stats(std::chrono::nanoseconds window) const;
+  // every sample still held, as Chrome trace JSON (chrome://tracing,
+  // ui.perfetto.dev); false if the file cannot be written
+  bool write_chrome_trace(const std::string& path) const;
+
+ private:
+  Profiler() : epoch(std::chrono::steady_clock::now()) {}
+  ProfileRing& ring();
+
+  const std::chrono::steady_clock::time_point epoch;
+  mutable std::mutex mutex;  // guards rings, not their contents
+  std::vector<std::unique_ptr<ProfileRing>> rings;
+};
+
+class ProfileScope {
+ public:
+  explicit ProfileScope(const char* name)
+      : name(name), start_ns(Profiler::get().now_ns()) {}
+  ~ProfileScope() {
+    Profiler::get().record(name, start_ns, Profiler::get().now_ns());
+  }
+  ProfileScope(const ProfileScope&) = delete;
+  ProfileScope& operator=(const ProfileScope&) = delete;
+
+ private:
+  const char* const name;
+  const int64_t start_ns;
+};
+
+// Percentiles of the last second drawn in the top left corner: one row per
+// section with bars for p50, p95 and p99, and the numbers next to them if a
+// monospace system font can be found.
+class ProfileOverlay {
+ public:
+  ProfileOverlay();
+  void toggle() { visible = !visible; }
+  void draw(sf::RenderTarget&);
+
+ private:
+  static constexpr float kRowHeight = 18;
+  static constexpr float kPixelsPerMs = 40;
+
+  bool visible = false;
+  bool has_font = false;
+  sf::Font font;
+  sf::Clock refresh;
+  std::vector<Profiler::Stats> stats;
+};
+
+inline void ProfileRing::push(const char* name, int64_t start_ns,
+                              int64_t duration_ns) {
+  const uint64_t n = head.load(std::memory_order_relaxed);
+  Slot& slot = slots[n & (kSize - 1)];
+  slot.name.store(name, std::memory_order_relaxed);
+  slot.start_ns.store(start_ns, std::memory_order_relaxed);
+  slot.duration_ns.store(duration_ns, std::memory_order_relaxed);
+  head.store(n + 1, std::memory_order_release);
+}
+
+// Slots the writer may have reused during the copy are dropped afterwards;
+// one slot of slack covers the sample being written right now.
+inline void ProfileRing::snapshot(std::vector<ProfileSample>& out) const {
+  const uint64_t end = head.load(std::memory_order_acquire);
+  const uint64_t begin = end > kSize - 1 ? end - (kSize - 1) : 0;
+  const size_t first = out.size();
+  for (uint64_t n = begin; n < end; ++n) {
+    const Slot& slot = slots[n & (kSize - 1)];
+    out.push_back({slot.name.load(std::memory_order_relaxed),
+                   slot.start_ns.load(std::memory_order_relaxed),
+                   slot.duration_ns.load(std::memory_order_relaxed)});
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  const uint64_t now = head.load(std::memory_order_relaxed);
+  const uint64_t valid = now > kSize - 1 ? now - (kSize - 1) : 0;
+  if (valid > begin) {
+    const size_t stale = std::min<uint64_t>(valid - begin, end - begin);
+    out.erase(out.begin() + first, out.begin() + first + stale);
+  }
+}
+
+inline Profiler& Profiler::get() {
+  static Profiler profiler;
+  return profiler;
+}
+
+inline int64_t Profiler::now_ns() const {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - epoch)
+      .count();
+}
+
+inline void Profiler::record(const char* name, int64_t start_ns,
+                             int64_t end_ns) {
+  ring().push(name, start_ns, end_ns - start_ns);
+}
+
+// Rings are never freed, so samples of finished threads stay readable.
+inline ProfileRing& Profiler::ring() {
+  thread_local ProfileRing* own = nullptr;
+  if (!own) {
+    std::lock_guard<std::mutex> lock(mutex);
+    rings.emplace_back(new ProfileRing(rings.size()));
+    own = rings.back().get();
+  }
+  return *own;
+}
+
+inline void Profiler::name_thread(const std::string& name) {
+  ProfileRing& own = ring();
+  std::lock_guard<std::mutex> lock(mutex);
+  own.thread_name = name;
+}
+
+inline std::vector<Profiler::Stats> Profiler::stats(
+    std::chrono::nanoseconds window) const {
+  std::vector<ProfileSample> samples;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto& ring : rings) ring->snapshot(samples);
+  }
+  const int64_t since = now_ns() - window.count();
+  std::map<std::string, std::vector<int64_t>> durations;
+  for (const ProfileSample& sample : samples) {
+    if (sample.start_ns >= since) {
+      durations[sample.name].push_back(sample.duration_ns);
+    }
+  }
+  std::vector<Stats> result;
+  for (auto& section : durations) {
+    std::vector<int64_t>& d = section.second;
+    std::sort(d.begin(), d.end());
+    auto at = [&d](double q) { return d[size_t(q * (d.size() - 1))] * 1e-6; };
+    result.push_back({section.first, at(0.5), at(0.95), at(0.99), d.size()});
+  }
+  return result;
+}
+
+inline bool Profiler::write_chrome_trace(const std::string& path) const {
+  std::ofstream out(path);
+  if (!out) return false;
+  std::lock_guard<std::mutex> lock(mutex);
+  out << "{\"traceEvents\": [\n";
+  const char* separator = "";
+  char line[256];
+  std::vector<ProfileSample> samples;
+  for (const auto& ring : rings) {
+    if (!ring->thread_name.empty()) {
+      out << separator << "{\"name\": \"thread_name\", \"ph\": \"M\", "
+          << "\"pid\": 1, \"tid\": " << ring->id
+          << ", \"args\": {\"name\": \"" << ring->thread_name << "\"}}";
+      separator = ",\n";
+    }
+    samples.clear();
+    ring->snapshot(samples);
+    for (const ProfileSample& sample : samples) {
+      std::snprintf(line, sizeof line,
+                    "{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, "
+                    "\"tid\": %d, \"ts\": %.3f, \"dur\": %.3f}",
+                    sample.name, ring->id, sample.start_ns * 1e-3,
+                    sample.duration_ns * 1e-3);
+      out << separator << line;
+      separator = ",\n";
+    }
+  }
+  out << "\n]}\n";
+  return bool(out);
+}
+
+inline ProfileOverlay::ProfileOverlay() {
+  const char* fonts[] = {
+      "/usr/share/fonts/truetype/dejavu/DejaVuSansMono.ttf",
+      "/usr/share/fonts/TTF/DejaVuSansMono.ttf",
+      "/Library/Fonts/Courier New.ttf",
+      "C:/Windows/Fonts/consola.ttf",
+  };
+  for (const char* path : fonts) {
+    // sf::Font complains on stderr about every file it cannot open
+    if (std::ifstream(path) && font.loadFromFile(path)) {
+      has_font = true;
+      break;
+    }
+  }
+}
+
+inline void ProfileOverlay::draw(sf::RenderTarget& target) {
+  if (!visible) return;
+  if (refresh.getElapsedTime().asMilliseconds() >= 250 || stats.empty()) {
+    stats = Profiler::get().stats(std::chrono::seconds(1));
+    refresh.restart();
+  }
+  sf::RectangleShape background(
+      sf::Vector2f(520, kRowHeight * (stats.size() + 1)));
+  background.setFillColor(sf::Color(0, 0, 0, 192));
+  target.draw(background);
+  sf::RectangleShape bar;
+  sf::Text text;
+  if (has_font) {
+    text.setFont(font);
+    text.setCharacterSize(12);
+    text.setFillColor(sf::Color::White);
+  }
+  char line[160];
+  for (size_t row = 0; row < stats.size(); ++row) {
+    const Profiler::Stats& s = stats[row];
+    const float y = kRowHeight * (row + 0.5f);
+    // longest first, each darker bar shows through behind the next
+    const double ms[3] = {s.p99_ms, s.p95_ms, s.p50_ms};
+    const sf::Uint8 green[3] = {64, 128, 255};
+    for (int k = 0; k < 3; ++k) {
+      bar.setSize(sf::Vector2f(std::min<float>(ms[k] * kPixelsPerMs, 200),
+                               kRowHeight - 4));
+      bar.setPosition(310, y + 2);
+      bar.setFillColor(sf::Color(0, green[k], 0));
+      target.draw(bar);
+    }
+    if (!has_font) continue;
+    std::snprintf(line, sizeof line, "%-16.16s %6.2f %6.2f %6.2f %5zu",
+                  s.name.c_str(), s.p50_ms, s.p95_ms, s.p99_ms, s.count);
+    text.setString(line);
+    text.setPosition(8, y);
+    target.draw(text);
+  }
+  if (has_font) {
+    std::snprintf(line, sizeof line, "%-16s %6s %6s %6s %5s", "section [ms]",
+                  "p50", "p95", "p99", "n/s");
+    text.setString(line);
+    text.setPosition(8, 0);
+    target.draw(text);
+  }
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Long-lived threads that run one task per worker and rendezvous once per
+// run(); the calling thread acts as worker 0. Shared by
+// conways_game_of_life and ml_classification_gui.
+class WorkerPool {
+ public:
+  using Task = std::function<void(unsigned)>;
+
+  explicit WorkerPool(unsigned threads = std::thread::hardware_concurrency());
+  ~WorkerPool();
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  unsigned size() const { return workers.size() + 1; }
+  // calls task(0), ..., task(size() - 1) concurrently and waits for all
+  void run(const Task& task);
+
+ private:
+  std::vector<std::thread> workers;
+  std::mutex mutex;
+  std::condition_variable start_cv;
+  std::condition_variable done_cv;
+  const Task* task = nullptr;
+  uint64_t generation = 0;
+  unsigned pending = 0;
+  bool stopping = false;
+
+  void work(unsigned index);
+};
+
+inline WorkerPool::WorkerPool(unsigned threads) {
+  threads = std::max(threads, 1u);
+  workers.reserve(threads - 1);
+  for (unsigned index = 1; index < threads; ++index) {
+    workers.emplace_back(&WorkerPool::work, this, index);
+  }
+}
+
+inline WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  start_cv.notify_all();
+  for (auto& worker : workers) worker.join();
+}
+
+inline void WorkerPool::run(const Task& job) {
+  if (workers.empty()) {
+    job(0);
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    task = &job;
+    pending = workers.size();
+    ++generation;
+  }
+  start_cv.notify_all();
+  job(0);
+  std::unique_lock<std::mutex> lock(mutex);
+  done_cv.wait(lock, [this] { return pending == 0; });
+  task = nullptr;
+}
+
+inline void WorkerPool::work(unsigned index) {
+  uint64_t seen = 0;
+  while (true) {
+    const Task* job;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      start_cv.wait(lock, [&] { return stopping || generation != seen; });
+      if (stopping) return;
+      seen = generation;
+      job = task;
+    }
+    (*job)(index);
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (--pending != 0) continue;
+    }
+    done_cv.notify_one();
+  }
+}
@@ -0,0 +1,301 @@
+/*
+ * Headless engine benchmark, opens no window.
+ *
+ * Usage:
+ *  benchmark [--engine image|byte|bitwise|lut|hashlife|sparse|process|all]
+ *            [--width 1920] [--height 1080] [--generations 100]
+ *            [--seed 0] [--warmup 1] [--repeat 5] [--threads N]
+ *            [--step 0] [--format json|csv] [--pattern file.rle]
+ *            [--time-block 1] [--stop-on-cycle 0|1]
+ *
+ * Every repetition starts from randomize(seed), or from the --pattern file
+ * centred on an empty table, and times `generations` generations; warmup
+ * repetitions are run the same way and discarded.
+ * --threads applies to bitwise and process (worker processes), --step
+ * (log2 generations per update) to hashlife, --time-block (generations per
+ * tiled pass) to image. One result per engine is printed: a JSON object per
+ * line or a CSV row. An engine that fails, e.g. because it cannot fork its
+ * workers, is reported as skipped on stderr.
+ *
+ * With --stop-on-cycle 1, engines that keep a board hash (image) end a
+ * repetition as soon as the board repeats a recent state, and the cycle's
+ * period and generation are reported.
+ */
+
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bit_cell_table.hpp"
+#include "byte_cell_table.hpp"
+#include "cycle_detector.hpp"
+#include "hashlife.hpp"
+#include "image_cell_table.hpp"
+#include "lut_cell_table.hpp"
+#include "pattern_io.hpp"
+#include "process_table.hpp"
+#include "sparse_table.hpp"
+
+struct Options {
+  std::string engine = "all";
+  unsigned int width = 1920;
+  unsigned int height = 1080;
+  uint64_t generations = 100;
+  uint64_t seed = 0;
+  unsigned int warmup = 1;
+  unsigned int repeat = 5;
+  unsigned int threads = std::thread::hardware_concurrency();
+  int step = 0;
+  std::string format = "json";
+  std::string pattern;
+  int time_block = 1;
+  bool stop_on_cycle = false;
+};
+
+struct Result {
+  std::string engine;
+  std::vector<double> seconds;  // one per measured repetition
+  uint64_t generations = 0;     // per repetition
+  uint64_t population = 0;      // live cells of the window after the last one
+  uint64_t cycle_period = 0;    // 0 if no cycle was found
+  uint64_t cycle_generation = 0;
+};
+
+uint64_t generations_per_update(const HashLife& table) {
+  return uint64_t(1) << table.get_step();
+}
+
+uint64_t generations_per_update(const ImageCellTable& table) {
+  return table.get_time_block();
+}
+
+template <typename Table>
+uint64_t generations_per_update(const Table&) {
+  return 1;
+}
+
+// false for tables that keep no board hash
+template <typename Table>
+bool board_hash(const Table&, uint64_t&, long) {
+  return false;
+}
+
+template <typename Table>
+auto board_hash(const Table& table, uint64_t& hash, int)
+    -> decltype(table.get_hash(), bool()) {
+  hash = table.get_hash();
+  return true;
+}
+
+template <typename Table>
+uint64_t population(const Table& table) {
+  uint64_t count = 0;
+  for (int j = 0; j < table.height; ++j) {
+    for (int i = 0; i < table.width; ++i) count += table.get_state(i, j);
+  }
+  return count;
+}
+
+template <typename Table>
+Result run(const std::string& engine, Table& table, const Options& options,
+           const PatternFile* pattern) {
+  using Clock = std::chrono::steady_clock;
+  Result result;
+  result.engine = engine;
+  for (unsigned int r = 0; r < options.warmup + options.repeat; ++r) {
+    if (pattern) {
+      table.clear();
+      pattern->load(table, (table.width - pattern->width()) / 2,
+                    (table.height - pattern->height()) / 2);
+    } else {
+      table.randomize(options.seed);
+    }
+    uint64_t done = 0, hash;
+    CycleDetector cycles;
+    const bool watch = options.stop_on_cycle && board_hash(table, hash, 0);
+    if (watch) cycles.observe(hash, 0);
+    auto start = Clock::now();
+    while (done < options.generations) {
+      table.update();
+      done += generations_per_update(table);
+      if (!watch) continue;
+      board_hash(table, hash, 0);
+      if (uint64_t period = cycles.observe(hash, done)) {
+        result.cycle_period = period;
+        result.cycle_generation = done;
+        break;
+      }
+    }
+    std::chrono::duration<double> elapsed = Clock::now() - start;
+    if (r >= options.warmup) result.seconds.push_back(elapsed.count());
+    result.generations = done;
+  }
+  result.population = population(table);
+  return result;
+}
+
+void print(const Result& result, const Options& options, bool header) {
+  std::vector<double> rates;  // generations per second
+  for (double s : result.seconds) rates.push_back(result.generations / s);
+  std::sort(rates.begin(), rates.end());
+  double mean = 0, variance = 0;
+  for (double rate : rates) mean += rate / rates.size();
+  for (double rate : rates) variance += (rate - mean) * (rate - mean);
+  size_t n = rates.size();
+  double stddev = n > 1 ? std::sqrt(variance / (n - 1)) : 0;
+  double median =
+      n % 2 ? rates[n / 2] : (rates[n / 2 - 1] + rates[n / 2]) / 2;
+  double cells = double(options.width) * options.height;
+  if (options.format == "csv") {
+    if (header) {
+      std::cout << "engine,width,height,generations,repeat,seed,threads,"
+                   "gens_per_sec_mean,gens_per_sec_median,gens_per_sec_min,"
+                   "gens_per_sec_max,gens_per_sec_stddev,"
+                   "cell_updates_per_sec,population,cycle_period,"
+                   "cycle_generation\n";
+    }
+    std::cout << result.engine << ',' << options.width << ','
+              << options.height << ',' << result.generations << ','
+              << n << ',' << options.seed << ',' << options.threads << ','
+              << mean << ',' << median << ',' << rates.front() << ','
+              << rates.back() << ',' << stddev << ',' << mean * cells << ','
+              << result.population << ',' << result.cycle_period << ','
+              << result.cycle_generation << '\n';
+  } else {
+    std::cout << "{\"engine\": \"" << result.engine << "\", \"width\": "
+              << options.width << ", \"height\": " << options.height
+              << ", \"generations\": " << result.generations
+              << ", \"repeat\": " << n << ", \"seed\": " << options.seed
+              << ", \"threads\": " << options.threads
+              << ", \"gens_per_sec\": {\"mean\": " << mean
+              << ", \"median\": " << median << ", \"min\": " << rates.front()
+              << ", \"max\": " << rates.back() << ", \"stddev\": " << stddev
+              << "}, \"cell_updates_per_sec\": " << mean * cells
+              << ", \"population\": " << result.population
+              << ", \"cycle_period\": " << result.cycle_period
+              << ", \"cycle_generation\": " << result.cycle_generation
+              << "}\n";
+  }
+}
+
+bool parse(int argc, char** argv, Options& options) {
+  for (int i = 1; i + 1 < argc; i += 2) {
+    std::string key = argv[i], value = argv[i + 1];
+    if (key == "--engine") {
+      options.engine = value;
+    } else if (key == "--width") {
+      options.width = std::stoul(value);
+    } else if (key == "--height") {
+      options.height = std::stoul(value);
+    } else if (key == "--generations") {
+      options.generations = std::stoull(value);
+    } else if (key == "--seed") {
+      options.seed = std::stoull(value);
+    } else if (key == "--warmup") {
+      options.warmup = std::stoul(value);
+    } else if (key == "--repeat") {
+      options.repeat = std::stoul(value);
+    } else if (key == "--threads") {
+      options.threads = std::stoul(value);
+    } else if (key == "--step") {
+      options.step = std::stoi(value);
+    } else if (key == "--format") {
+      options.format = value;
+    } else if (key == "--pattern") {
+      options.pattern = value;
+    } else if (key == "--time-block") {
+      options.time_block = std::stoi(value);
+    } else if (key == "--stop-on-cycle") {
+      options.stop_on_cycle = std::stoi(value) != 0;
+    } else {
+      return false;
+    }
+  }
+  return argc % 2 == 1 && options.repeat > 0 && options.width > 0 &&
+         options.height > 0 &&
+         (options.format == "json" || options.format == "csv");
+}
+
+int main(int argc, char** argv) {
+  Options options;
+  try {
+    if (!parse(argc, argv, options)) throw std::invalid_argument("usage");
+  } catch (const std::exception&) {
+    std::cerr << "usage: benchmark [--engine image|byte|bitwise|lut|"
+                 "hashlife|sparse|process|all] [--width W] [--height H] "
+                 "[--generations G] [--seed S] [--warmup N] [--repeat N] "
+                 "[--threads N] [--step K] [--format json|csv] "
+                 "[--pattern FILE] [--time-block K] [--stop-on-cycle 0|1]\n";
+    return 1;
+  }
+  std::unique_ptr<PatternFile> pattern;
+  if (!options.pattern.empty()) {
+    try {
+      pattern.reset(new PatternFile(options.pattern));
+    } catch (const std::exception& error) {
+      std::cerr << error.what() << '\n';
+      return 1;
+    }
+  }
+  const sf::Vector2u size(options.width, options.height);
+  const bool all = options.engine == "all";
+  bool header = true, found = false;
+  auto report = [&](const Result& result) {
+    print(result, options, header);
+    header = false;
+    found = true;
+  };
+  // an engine that cannot run these options is reported as skipped, and
+  // the others still run
+  auto attempt = [&](const std::string& engine, auto body) {
+    if (!all && options.engine != engine) return;
+    found = true;
+    try {
+      body();
+    } catch (const std::exception& error) {
+      std::cerr << engine << " skipped: " << error.what() << '\n';
+    }
+  };
+  attempt("image", [&] {
+    ImageCellTable table(size);
+    table.set_time_block(options.time_block);
+    report(run("image", table, options, pattern.get()));
+  });
+  attempt("byte", [&] {
+    ByteCellTable table(size);
+    report(run("byte", table, options, pattern.get()));
+  });
+  attempt("bitwise", [&] {
+    BitCellTable table(size, options.threads);
+    report(run("bitwise", table, options, pattern.get()));
+  });
+  attempt("lut", [&] {
+    LutCellTable table(size);
+    report(run("lut", table, options, pattern.get()));
+  });
+  attempt("hashlife", [&] {
+    HashLife table(size, options.step);
+    report(run("hashlife", table, options, pattern.get()));
+  });
+  attempt("sparse", [&] {
+    SparseTable table(size);
+    report(run("sparse", table, options, pattern.get()));
+  });
+  attempt("process", [&] {
+    ProcessTable table(size, options.threads);
+    report(run("process", table, options, pattern.get()));
+  });
+  if (!found) {
+    std::cerr << "unknown engine " << options.engine << '\n';
+    return 1;
+  }
+  return 0;
+}
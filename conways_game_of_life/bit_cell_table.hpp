@@ -0,0 +1,264 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../common/worker_pool.hpp"
+#include "bit_life.hpp"
+#include "viewport.hpp"
+
+// Toroidal table that keeps 64 cells per word (cell i of a row is bit i % 64
+// of word i / 64) and advances whole words with bitwise adders. Generations
+// are split into horizontal bands, one per pool worker.
+//
+// The table is also divided into tiles of one word by kTileRows rows. A tile
+// is recomputed only if it or one of its eight neighbours changed during the
+// previous generation; the others are stable and keep their words.
+class BitCellTable {
+ public:
+  using Word = uint64_t;
+  static constexpr int kWordBits = 64;
+  static constexpr int kTileRows = 32;
+  // rows of a pixel's block that sample() counts when zoomed out
+  static constexpr int kSampleRows = 16;
+
+  BitCellTable(const sf::Vector2u&,
+               unsigned threads = std::thread::hardware_concurrency());
+  bool get_state(int, int) const;
+  void set_state(int, int, bool);
+  void clear();
+  void randomize();
+  void randomize(uint64_t seed);
+  void update();
+
+  const Word* row(int j) const { return cells.data() + j * words_per_row; }
+  // all rows back to back, as used by History
+  const std::vector<Word>& get_words() const { return cells; }
+  void set_words(const std::vector<Word>&);
+  // calls f(i, j) for every live cell
+  template <typename F>
+  void for_each_alive(F f) const;
+  // Fills columns x rows pixels with density_color() of the viewport, in
+  // parallel. Zoomed out, blocks are counted with popcounts over at most
+  // kSampleRows evenly spaced rows, so the cost follows the screen rather
+  // than the world.
+  void sample(const Viewport&, int columns, int rows, uint32_t* pixels);
+  // number of tiles recomputed by the last update()
+  int get_active_tiles() const { return active_tiles; }
+
+  const int width;
+  const int height;
+  const int words_per_row;
+  const int tile_rows;  // rows of tiles, each row has words_per_row tiles
+
+ private:
+  void fill_random(std::mt19937_64&);
+  std::vector<Word> cells;
+  std::vector<Word> next;
+  const Word last_word_mask;
+  // changed[t] == 0 guarantees that cells and next hold the same words in
+  // tile t, so skipping the tile leaves the right generation in both buffers
+  std::vector<uint8_t> changed;
+  std::vector<uint8_t> active;
+  int active_tiles;
+  WorkerPool pool;
+
+  void mark_active();
+  void update_row(int);
+  int count_alive(int j, int begin, int end) const;
+};
+
+inline BitCellTable::BitCellTable(const sf::Vector2u& size, unsigned threads)
+    : width(size.x),
+      height(size.y),
+      words_per_row((size.x + kWordBits - 1) / kWordBits),
+      tile_rows((size.y + kTileRows - 1) / kTileRows),
+      cells(words_per_row * size.y),
+      next(words_per_row * size.y),
+      last_word_mask(~Word() >> (words_per_row * kWordBits - width)),
+      changed(words_per_row * tile_rows),
+      active(words_per_row * tile_rows),
+      active_tiles(0),
+      pool(std::min<unsigned>(threads, tile_rows)) {
+  randomize();
+}
+
+inline bool BitCellTable::get_state(int i, int j) const {
+  return (row(j)[i / kWordBits] >> (i % kWordBits)) & 1;
+}
+
+inline void BitCellTable::set_state(int i, int j, bool state) {
+  Word& word = cells[j * words_per_row + i / kWordBits];
+  Word bit = Word(1) << (i % kWordBits);
+  word = state ? word | bit : word & ~bit;
+  changed[j / kTileRows * words_per_row + i / kWordBits] = 1;
+}
+
+inline void BitCellTable::clear() {
+  std::fill(cells.begin(), cells.end(), Word());
+  std::fill(changed.begin(), changed.end(), 1);
+}
+
+inline void BitCellTable::set_words(const std::vector<Word>& words) {
+  std::copy(words.begin(), words.end(), cells.begin());
+  std::fill(changed.begin(), changed.end(), 1);
+}
+
+// same bit stream and cell order as the ImageCellTable::randomize()
+inline void BitCellTable::randomize() {
+  static std::mt19937_64 rnd;
+  fill_random(rnd);
+}
+
+inline void BitCellTable::randomize(uint64_t seed) {
+  std::mt19937_64 rnd(seed);
+  fill_random(rnd);
+}
+
+inline void BitCellTable::fill_random(std::mt19937_64& rnd) {
+  for (int j = 0; j < height; ++j) {
+    Word* words = cells.data() + j * words_per_row;
+    for (int k = 0; k < words_per_row; ++k) words[k] = rnd();
+    words[words_per_row - 1] &= last_word_mask;
+  }
+  std::fill(changed.begin(), changed.end(), 1);
+}
+
+template <typename F>
+void BitCellTable::for_each_alive(F f) const {
+  for (int j = 0; j < height; ++j) {
+    const Word* words = row(j);
+    for (int k = 0; k < words_per_row; ++k) {
+      Word word = words[k];
+      for (int i = k * kWordBits; word; ++i, word >>= 1) {
+        if (word & 1) f(i, j);
+      }
+    }
+  }
+}
+
+// Pixel rows are split into bands, one per worker, and every sampled cell
+// row is swept left to right across all pixel columns.
+inline void BitCellTable::sample(const Viewport& view, int columns, int rows,
+                                 uint32_t* pixels) {
+  std::vector<int> begin(columns), end(columns);
+  for (int px = 0; px < columns; ++px) {
+    const int x = view.cell_x(px);
+    begin[px] = std::max(x, 0);
+    end[px] = std::min(std::max(view.cell_x(px + 1), x + 1), width);
+  }
+  const int bands = pool.size();
+  pool.run([&, bands](unsigned worker) {
+    const int band = worker;
+    std::vector<int> alive(columns);
+    for (int py = rows * band / bands; py < rows * (band + 1) / bands; ++py) {
+      const int y = view.cell_y(py);
+      const int j0 = std::max(y, 0);
+      const int j1 = std::min(std::max(view.cell_y(py + 1), y + 1), height);
+      const int stride = std::max((j1 - j0) / kSampleRows, 1);
+      std::fill(alive.begin(), alive.end(), 0);
+      int sampled = 0;
+      for (int j = j0; j < j1; j += stride, ++sampled) {
+        for (int px = 0; px < columns; ++px) {
+          if (begin[px] < end[px]) {
+            alive[px] += count_alive(j, begin[px], end[px]);
+          }
+        }
+      }
+      uint32_t* out = pixels + py * columns;
+      for (int px = 0; px < columns; ++px) {
+        const int cells = std::max(end[px] - begin[px], 0) * sampled;
+        out[px] = density_color(alive[px], cells);
+      }
+    }
+  });
+}
+
+// live cells of row j in columns [begin, end)
+inline int BitCellTable::count_alive(int j, int begin, int end) const {
+  const Word* words = row(j);
+  const int first = begin / kWordBits, last = (end - 1) / kWordBits;
+  if (first == last) {
+    const Word mask = ~Word() >> (kWordBits - (end - begin));
+    return __builtin_popcountll(words[first] >> (begin % kWordBits) & mask);
+  }
+  int count = 0;
+  for (int k = first; k <= last; ++k) {
+    Word word = words[k];
+    if (k == first) word &= ~Word() << (begin % kWordBits);
+    if (k == last) word &= ~Word() >> (kWordBits - 1 - (end - 1) % kWordBits);
+    count += __builtin_popcountll(word);
+  }
+  return count;
+}
+
+// Rows only read the previous generation, so bands need no halo exchange:
+// the rows across a band edge or the torus seam are simply read from cells.
+// Bands are whole rows of tiles, so no two workers share a changed flag.
+inline void BitCellTable::update() {
+  mark_active();
+  if (active_tiles == 0) return;
+  std::fill(changed.begin(), changed.end(), 0);
+  const int bands = pool.size();
+  pool.run([this, bands](unsigned worker) {
+    const int band = worker;
+    int begin = tile_rows * band / bands * kTileRows;
+    int end = std::min(tile_rows * (band + 1) / bands * kTileRows, height);
+    for (int j = begin; j < end; ++j) update_row(j);
+  });
+  cells.swap(next);
+}
+
+// a tile is active if any tile of its toroidal 3x3 block changed
+inline void BitCellTable::mark_active() {
+  active_tiles = 0;
+  for (int ty = 0; ty < tile_rows; ++ty) {
+    const uint8_t* rows[3] = {
+        changed.data() + (ty == 0 ? tile_rows - 1 : ty - 1) * words_per_row,
+        changed.data() + ty * words_per_row,
+        changed.data() +
+            (ty == tile_rows - 1 ? 0 : ty + 1) * words_per_row};
+    for (int tx = 0; tx < words_per_row; ++tx) {
+      int l = tx == 0 ? words_per_row - 1 : tx - 1;
+      int r = tx == words_per_row - 1 ? 0 : tx + 1;
+      uint8_t any = 0;
+      for (auto flags : rows) any |= flags[l] | flags[tx] | flags[r];
+      active[ty * words_per_row + tx] = any;
+      active_tiles += any;
+    }
+  }
+}
+
+// Neighbours of bit b of word k are bits b-1, b, b+1 of the rows above and
+// below and bits b-1, b+1 of the row itself. Every row is shifted by one bit
+// in both directions, carrying across word borders and around the torus.
+inline void BitCellTable::update_row(int j) {
+  const int last = words_per_row - 1;
+  const int tail = (width - 1) % kWordBits;  // position of the last cell
+  const Word* rows[3] = {row(j == 0 ? height - 1 : j - 1), row(j),
+                         row(j == height - 1 ? 0 : j + 1)};
+  const uint8_t* is_active = active.data() + j / kTileRows * words_per_row;
+  uint8_t* has_changed = changed.data() + j / kTileRows * words_per_row;
+  Word* out = next.data() + j * words_per_row;
+  for (int k = 0; k <= last; ++k) {
+    if (!is_active[k]) continue;
+    Word w[3], c[3], e[3];
+    for (int r = 0; r < 3; ++r) {
+      const Word* words = rows[r];
+      Word prev =
+          k == 0 ? words[last] >> tail : words[k - 1] >> (kWordBits - 1);
+      c[r] = words[k];
+      w[r] = (c[r] << 1) | (prev & 1);
+      e[r] = k == last ? (c[r] >> 1) | ((words[0] & 1) << tail)
+                       : (c[r] >> 1) | (words[k + 1] << (kWordBits - 1));
+    }
+    Word result = next_bits(w, c, e);
+    if (k == last) result &= last_word_mask;
+    out[k] = result;
+    has_changed[k] |= result != c[1];
+  }
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+
+// Next state of 64 cells in one word of bitboards. w, c and e hold the rows
+// above ([0]), at ([1]) and below ([2]) the word, shifted so that bit b is
+// the west neighbour, the cell itself and the east neighbour of cell b.
+// The eight neighbour bitboards are summed with full adders.
+inline uint64_t next_bits(const uint64_t w[3], const uint64_t c[3],
+                          const uint64_t e[3]) {
+  // 2-bit sums of the upper and lower triples and of the middle pair
+  uint64_t up0 = w[0] ^ c[0] ^ e[0];
+  uint64_t up1 = (w[0] & c[0]) | (e[0] & (w[0] ^ c[0]));
+  uint64_t down0 = w[2] ^ c[2] ^ e[2];
+  uint64_t down1 = (w[2] & c[2]) | (e[2] & (w[2] ^ c[2]));
+  uint64_t mid0 = w[1] ^ e[1];
+  uint64_t mid1 = w[1] & e[1];
+  // ones digit of the total and the carry it produces
+  uint64_t ones = up0 ^ down0 ^ mid0;
+  uint64_t carry = (up0 & down0) | (mid0 & (up0 ^ down0));
+  // the total is 2 or 3 iff exactly one of the twos digits is set
+  uint64_t p = up1 ^ down1;
+  uint64_t q = mid1 ^ carry;
+  uint64_t single_two = (p ^ q) & ~((up1 & down1) | (mid1 & carry) | (p & q));
+  return single_two & (ones | c[1]);
+}
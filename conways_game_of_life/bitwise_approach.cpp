@@ -0,0 +1,59 @@
+#include <SFML/Graphics.hpp>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#include "bit_cell_table.hpp"
+#include "game_of_life.hpp"
+#include "history.hpp"
+
+// BitCellTable that records every generation, so R can step back through
+// them; edits between two generations end up in the next recorded delta
+class RewindableTable : public BitCellTable {
+ public:
+  RewindableTable(const sf::Vector2u& size, unsigned threads,
+                  size_t history_mb)
+      : BitCellTable(size, threads), history(history_mb << 20) {}
+
+  void update() {
+    if (history.get_generations() == 0) history.record(get_words());
+    BitCellTable::update();
+    history.record(get_words());
+  }
+  void rewind() {
+    if (history.step_back(words)) set_words(words);
+  }
+
+ private:
+  History history;
+  std::vector<Word> words;
+};
+
+int main(int argc, char** argv) {
+  const unsigned int fps_max = 0, history_mb = 256,
+                     threads = std::thread::hardware_concurrency();
+  GUI gui(fps_max);
+  RewindableTable table(world_size(argc, argv, gui), threads, history_mb);
+  try {
+    if (const char* path = pattern_path(argc, argv)) load_pattern(table, path);
+  } catch (const std::exception& error) {
+    std::cerr << error.what() << '\n';
+    return 1;
+  }
+  gui.show_world(sf::Vector2u(table.width, table.height));
+  PixelSimulation<RewindableTable> simulation(
+      table, capture_view<RewindableTable>(gui));
+  Events<RewindableTable> events(gui, simulation);
+
+  int frame_counter = 0;
+  while (gui.window.isOpen() && ++frame_counter <= 40) {
+    gui.display(simulation.acquire());
+    events.handle();
+  }
+  auto calc_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+      simulation.get_calc_time());
+  std::cout << gui.clock.getElapsedTime().asMilliseconds() << '\n';
+  std::cout << calc_time.count() << '\n';
+  std::cout << simulation.get_updates() << '\n';
+  return 0;
+}
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <random>
+#include <vector>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define GOL_X86_DISPATCH
+#endif
+
+// Toroidal table with one byte per cell
+class ByteCellTable {
+ public:
+  using Bool = uint8_t;
+  ByteCellTable(const sf::Vector2u&);
+  Bool at(int i, int j) const { return cells[i + j * width]; }
+  bool get_state(int i, int j) const { return at(i, j); }
+  const std::vector<Bool>& get_cells() const { return cells; }
+  void toggle(int, int);
+  void set_state(int i, int j, bool state) {
+    if (at(i, j) != state) toggle(i, j);
+  }
+  void clear();
+  void randomize();
+  void randomize(uint64_t seed);
+  void update();
+
+  // Computes the next state of cells [begin, end) of the middle row, which
+  // need their left and right neighbours in memory. Also used by other
+  // tables that keep one byte per cell.
+  using RowKernel = void (*)(const Bool*, const Bool*, const Bool*, Bool*,
+                             int, int);
+  // the widest kernel the CPU runs, nullptr if only scalar code is usable
+  static RowKernel select_kernel();
+  // the next state of cell i of the middle row, with neighbours l and r
+  static Bool next_state(const Bool*, const Bool*, const Bool*, int, int, int);
+
+  const int width;
+  const int height;
+
+ private:
+  void fill_random(std::mt19937_64&);
+
+  std::vector<Bool> cells;
+  std::vector<uint8_t> neighbors;  // next generation in the vectorized path
+  const RowKernel kernel;          // nullptr if only scalar code is usable
+
+  void update_scalar();
+  void update_vectorized();
+  void fix_neighbors(int, int);
+
+#ifdef GOL_X86_DISPATCH
+  static void update_row_sse2(const Bool*, const Bool*, const Bool*, Bool*,
+                              int, int);
+  static void update_row_avx2(const Bool*, const Bool*, const Bool*, Bool*,
+                              int, int);
+  static __m128i load(const uint8_t*);
+  static __m256i load256(const uint8_t*);
+#endif
+};
+
+inline ByteCellTable::ByteCellTable(
+    const sf::Vector2u& size) : width(size.x),
+                                height(size.y),
+                                cells(size.x * size.y),
+                                neighbors(size.x * size.y),
+                                kernel(select_kernel()) {
+  randomize();
+}
+
+inline void ByteCellTable::toggle(int i, int j) {
+  int index = i + j * width;
+  cells[index] = !cells[index];
+}
+
+inline void ByteCellTable::clear() {
+  std::fill(cells.begin(), cells.end(), Bool());
+}
+
+inline void ByteCellTable::randomize() {
+  static std::mt19937_64 rnd;
+  fill_random(rnd);
+}
+
+inline void ByteCellTable::randomize(uint64_t seed) {
+  std::mt19937_64 rnd(seed);
+  fill_random(rnd);
+}
+
+inline void ByteCellTable::fill_random(std::mt19937_64& rnd) {
+  uint64_t num = 0;
+  for (int j = 0; j < height; ++j) {
+    for (int i = 0; i < width; ++i, num >>= 1) {
+      if ((i & 0x3F) == 0) num = rnd();
+      if (at(i, j) != (num & 1)) toggle(i, j);
+    }
+  }
+}
+
+inline void ByteCellTable::update() {
+  if (kernel) {
+    update_vectorized();
+  } else {
+    update_scalar();
+  }
+}
+
+inline void ByteCellTable::update_scalar() {
+  std::fill(neighbors.begin(), neighbors.end(), uint8_t());
+  for (int j = 0; j < height; ++j) {
+    for (int i = 0; i < width; ++i) {
+      if (at(i, j)) fix_neighbors(i, j);
+    }
+  }
+  for (int j = 0; j < height; ++j) {
+    for (int i = 0; i < width; ++i) {
+      int index = i + j * width;
+      if (cells[index]) {
+        if (neighbors[index] < 2 || neighbors[index] > 3) {
+          toggle(i, j);
+        }
+      } else if (neighbors[index] == 3) {
+        toggle(i, j);
+      }
+    }
+  }
+}
+
+inline void ByteCellTable::fix_neighbors(int i, int j) {
+  const int offsets[8][2] = {
+      {-1, -1}, {0, -1}, {1, -1}, {-1, 0}, {1, 0}, {-1, 1}, {0, 1}, {1, 1}};
+  for (auto offset : offsets) {
+    int io = i + offset[0];
+    int jo = j + offset[1];
+    if (io < 0) io += width;
+    if (io >= width) io -= width;
+    if (jo < 0) jo += height;
+    if (jo >= height) jo -= height;
+    ++neighbors[io + jo * width];
+  }
+}
+
+// Gathers the three-row neighbourhood of every cell instead of scattering
+// increments. Only the first and last columns wrap, the rest of the row is
+// left to the SIMD kernel.
+inline void ByteCellTable::update_vectorized() {
+  for (int j = 0; j < height; ++j) {
+    const Bool* up = cells.data() + (j == 0 ? height - 1 : j - 1) * width;
+    const Bool* mid = cells.data() + j * width;
+    const Bool* down = cells.data() + (j == height - 1 ? 0 : j + 1) * width;
+    Bool* out = neighbors.data() + j * width;
+    out[0] = next_state(up, mid, down, width - 1, 0, width > 1 ? 1 : 0);
+    out[width - 1] = next_state(up, mid, down, width > 1 ? width - 2 : 0,
+                                width - 1, 0);
+    if (width > 2) kernel(up, mid, down, out, 1, width - 1);
+  }
+  cells.swap(neighbors);
+}
+
+inline ByteCellTable::RowKernel ByteCellTable::select_kernel() {
+#ifdef GOL_X86_DISPATCH
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) return update_row_avx2;
+  if (__builtin_cpu_supports("sse2")) return update_row_sse2;
+#endif
+  return nullptr;
+}
+
+inline ByteCellTable::Bool ByteCellTable::next_state(const Bool* up,
+                                                     const Bool* mid,
+                                                     const Bool* down, int l,
+                                                     int i, int r) {
+  int sum = up[l] + up[i] + up[r] + mid[l] + mid[r] + down[l] + down[i] +
+            down[r];
+  return sum == 3 || (mid[i] && sum == 2);
+}
+
+#ifdef GOL_X86_DISPATCH
+__attribute__((target("sse2"))) inline __m128i ByteCellTable::load(
+    const uint8_t* p) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+__attribute__((target("avx2"))) inline __m256i ByteCellTable::load256(
+    const uint8_t* p) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+}
+
+__attribute__((target("sse2"))) inline void ByteCellTable::update_row_sse2(
+    const Bool* up, const Bool* mid, const Bool* down, Bool* out, int begin,
+    int end) {
+  const __m128i zero = _mm_setzero_si128(), one = _mm_set1_epi8(1),
+                two = _mm_set1_epi8(2), three = _mm_set1_epi8(3);
+  int i = begin;
+  for (; i + 16 <= end; i += 16) {
+    __m128i sum = _mm_add_epi8(load(up + i - 1), load(up + i));
+    sum = _mm_add_epi8(sum, load(up + i + 1));
+    sum = _mm_add_epi8(sum, load(mid + i - 1));
+    sum = _mm_add_epi8(sum, load(mid + i + 1));
+    sum = _mm_add_epi8(sum, load(down + i - 1));
+    sum = _mm_add_epi8(sum, load(down + i));
+    sum = _mm_add_epi8(sum, load(down + i + 1));
+    __m128i alive = _mm_cmpgt_epi8(load(mid + i), zero);
+    __m128i born = _mm_cmpeq_epi8(sum, three);
+    __m128i survive = _mm_and_si128(alive, _mm_cmpeq_epi8(sum, two));
+    __m128i state = _mm_and_si128(_mm_or_si128(born, survive), one);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), state);
+  }
+  for (; i < end; ++i) out[i] = next_state(up, mid, down, i - 1, i, i + 1);
+}
+
+__attribute__((target("avx2"))) inline void ByteCellTable::update_row_avx2(
+    const Bool* up, const Bool* mid, const Bool* down, Bool* out, int begin,
+    int end) {
+  const __m256i zero = _mm256_setzero_si256(), one = _mm256_set1_epi8(1),
+                two = _mm256_set1_epi8(2), three = _mm256_set1_epi8(3);
+  int i = begin;
+  for (; i + 32 <= end; i += 32) {
+    __m256i sum = _mm256_add_epi8(load256(up + i - 1), load256(up + i));
+    sum = _mm256_add_epi8(sum, load256(up + i + 1));
+    sum = _mm256_add_epi8(sum, load256(mid + i - 1));
+    sum = _mm256_add_epi8(sum, load256(mid + i + 1));
+    sum = _mm256_add_epi8(sum, load256(down + i - 1));
+    sum = _mm256_add_epi8(sum, load256(down + i));
+    sum = _mm256_add_epi8(sum, load256(down + i + 1));
+    // alive cells keep "sum == 2 || sum == 3", dead ones only "sum == 3"
+    __m256i alive = _mm256_cmpgt_epi8(load256(mid + i), zero);
+    __m256i born = _mm256_cmpeq_epi8(sum, three);
+    __m256i survive = _mm256_or_si256(born, _mm256_cmpeq_epi8(sum, two));
+    __m256i state = _mm256_blendv_epi8(born, survive, alive);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i),
+                        _mm256_and_si256(state, one));
+  }
+  update_row_sse2(up, mid, down, out, i, end);
+}
+#endif
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+
+// Remembers the board hashes of the last kWindow generations and notices
+// when the newest one repeats an earlier one: the board has entered a cycle
+// whose period is the distance between the two, 1 for a still life.
+class CycleDetector {
+ public:
+  static constexpr int kWindow = 64;
+
+  // the period if hash was seen within the window, else 0
+  uint64_t observe(uint64_t hash, uint64_t generation);
+  void reset() { count = next = 0; }
+
+ private:
+  uint64_t hashes[kWindow];
+  uint64_t generations[kWindow];
+  int count = 0;  // filled entries
+  int next = 0;   // entry to overwrite
+};
+
+inline uint64_t CycleDetector::observe(uint64_t hash, uint64_t generation) {
+  uint64_t period = 0;
+  for (int k = 0; k < count; ++k) {
+    if (hashes[k] == hash) {
+      const uint64_t distance = generation - generations[k];
+      if (period == 0 || distance < period) period = distance;
+    }
+  }
+  hashes[next] = hash;
+  generations[next] = generation;
+  next = (next + 1) % kWindow;
+  if (count < kWindow) ++count;
+  return period;
+}
@@ -0,0 +1,455 @@
+/*
+ * Hotkeys:
+ *  Escape   (close)
+ *  C        (clear)
+ *  N        (new table with random cells)
+ *  P        (pause and show mouse coursor)
+ *  F        (unlock fps)
+ *  Arrows   (pan)
+ *  +/-      (zoom in/out, the mouse wheel zooms around the cursor)
+ *  Home     (show the whole world)
+ *  S        (save the live cells to saved.rle)
+ *  R        (pause and rewind one generation, P replays from there)
+ *  O        (show section timings)
+ *  T        (write the recorded timings to trace.json)
+ *
+ * Command line: program [width height] [pattern.rle|pattern.cells]
+ */
+
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../common/profiler.hpp"
+#include "pattern_io.hpp"
+#include "simulation.hpp"
+#include "viewport.hpp"
+
+// Window and event handling shared by the engine programs. A Table provides
+// width, height, get_state, set_state, clear, randomize, update,
+// for_each_alive(f), which calls f(i, j) for every live cell of the world,
+// and for_each_alive_in(x0, y0, x1, y1, f), which does the same for the
+// cells in [x0, x1) x [y0, y1) only, unless it has a sample() member. The
+// table itself belongs to the simulation thread; the window only sees the
+// PixelFrames it publishes.
+struct PixelFrame {
+  unsigned int width = 0;
+  unsigned int height = 0;
+  std::vector<uint32_t> pixels;  // RGBA, white for live cells
+  // Set by captures that track changes: the regions that differ from the
+  // capture before, which had serial - 1. Without them the whole frame is
+  // uploaded.
+  bool has_dirty = false;
+  uint64_t serial = 0;
+  std::vector<sf::IntRect> dirty;
+};
+
+template <typename Table>
+using PixelSimulation = Simulation<Table, PixelFrame>;
+
+// Fills columns x rows pixels with density_color() of the viewport, on the
+// calling thread. Zoomed in, every pixel reads one cell; zoomed out, the
+// live cells of the visible rectangle are binned into their pixels. That
+// costs what the table's for_each_alive_in() costs for the rectangle: its
+// area for the dense tables, and the nodes or chunks that overlap it for
+// HashLife and SparseTable, so it grows with the view, not the world, but
+// a zoomed out view of a dense world still visits every cell in it. Tables
+// with a sample() member of the same shape, which may work in parallel,
+// are asked to do it themselves.
+template <typename Table>
+void sample_view(const Table& table, const Viewport& view, int columns,
+                 int rows, uint32_t* pixels, long) {
+  if (view.zoom <= 0) {
+    for (int py = 0; py < rows; ++py) {
+      const int j = view.cell_y(py);
+      for (int px = 0; px < columns; ++px) {
+        const int i = view.cell_x(px);
+        const bool inside =
+            i >= 0 && i < table.width && j >= 0 && j < table.height;
+        pixels[px + py * columns] =
+            density_color(inside && table.get_state(i, j), inside);
+      }
+    }
+    return;
+  }
+  std::fill(pixels, pixels + columns * rows, 0);
+  table.for_each_alive_in(
+      view.x, view.y, view.cell_x(columns), view.cell_y(rows),
+      [&](int i, int j) {
+        const int px = (i - view.x) >> view.zoom;
+        const int py = (j - view.y) >> view.zoom;
+        ++pixels[px + py * columns];
+      });
+  for (int py = 0; py < rows; ++py) {
+    const int j0 = std::max(view.cell_y(py), 0);
+    const int j1 = std::min(view.cell_y(py + 1), table.height);
+    for (int px = 0; px < columns; ++px) {
+      const int i0 = std::max(view.cell_x(px), 0);
+      const int i1 = std::min(view.cell_x(px + 1), table.width);
+      const int cells = std::max(i1 - i0, 0) * std::max(j1 - j0, 0);
+      uint32_t& pixel = pixels[px + py * columns];
+      pixel = density_color(pixel, cells);
+    }
+  }
+}
+
+template <typename Table>
+auto sample_view(Table& table, const Viewport& view, int columns, int rows,
+                 uint32_t* pixels, int)
+    -> decltype(table.sample(view, columns, rows, pixels)) {
+  return table.sample(view, columns, rows, pixels);
+}
+
+template <typename Table>
+void render_view(Table& table, const Viewport& view, sf::Vector2u screen,
+                 PixelFrame& frame) {
+  frame.width = screen.x;
+  frame.height = screen.y;
+  frame.has_dirty = false;
+  frame.pixels.resize(screen.x * screen.y);
+  sample_view(table, view, screen.x, screen.y, frame.pixels.data(), 0);
+}
+
+struct GUI {
+  sf::RenderWindow window;
+  sf::Texture texture;
+  sf::Sprite sprite;
+  const sf::Clock clock;
+  const sf::Vector2u screen;
+  const unsigned int fps_max;
+  bool is_paused;
+  sf::Vector2u world;
+  Viewport view;  // render thread only, captures read shared_view
+  SharedViewport shared_view;
+  ProfileOverlay overlay;
+
+  explicit GUI(unsigned int fps_max);
+  // shows the last uploaded frame again if frame is nullptr
+  void display(const PixelFrame* frame);
+  // remembers the world size and zooms out until all of it is visible
+  void show_world(sf::Vector2u size);
+  // zooms by 2^steps, keeping the cell under pixel (px, py) in place
+  void zoom(int steps, int px, int py);
+  void pan(int dx, int dy);  // by pixels
+
+ private:
+  uint64_t shown_serial = 0;
+  std::vector<uint32_t> patch;
+
+  void upload(const PixelFrame&);
+};
+
+// A Capture that renders whatever part of the world the GUI looks at
+template <typename Table>
+typename PixelSimulation<Table>::Capture capture_view(const GUI& gui) {
+  return [&gui](Table& table, PixelFrame& frame) {
+    render_view(table, gui.shared_view.load(), gui.screen, frame);
+  };
+}
+
+// Width and height from argv[1] and argv[2]. The tables index their cells
+// with int, so both must be positive and their product must fit in one;
+// anything else prints a usage error and exits.
+inline sf::Vector2u parse_world_size(char** argv) {
+  long side[2];
+  for (int k = 0; k < 2; ++k) {
+    char* end = nullptr;
+    errno = 0;
+    side[k] = std::strtol(argv[k + 1], &end, 10);
+    if (end == argv[k + 1] || *end != '\0' || errno == ERANGE ||
+        side[k] > INT_MAX) {
+      side[k] = 0;
+    }
+  }
+  if (side[0] <= 0 || side[1] <= 0 || side[0] > INT_MAX / side[1]) {
+    std::cerr << "usage: " << argv[0] << " [width height] [pattern]\n"
+              << "width and height must be positive integers whose product "
+              << "is at most " << INT_MAX << ", got \"" << argv[1] << "\" \""
+              << argv[2] << "\"\n";
+    std::exit(1);
+  }
+  return sf::Vector2u(side[0], side[1]);
+}
+
+// world size from the command line, else the screen
+inline sf::Vector2u world_size(int argc, char** argv, const GUI& gui) {
+  if (argc < 3) return gui.screen;
+  return parse_world_size(argv);
+}
+
+// the same without a window, for tables that must exist before the GUI;
+// the full screen window takes the desktop mode
+inline sf::Vector2u world_size(int argc, char** argv) {
+  if (argc >= 3) return parse_world_size(argv);
+  const sf::VideoMode desktop = sf::VideoMode::getDesktopMode();
+  return sf::Vector2u(desktop.width, desktop.height);
+}
+
+// pattern file from the command line, or nullptr
+inline const char* pattern_path(int argc, char** argv) {
+  return argc % 2 == 0 ? argv[argc - 1] : nullptr;
+}
+
+// Removes "name value" from the command line and returns value, or nullptr
+// if name is not there; call it before world_size() and pattern_path().
+inline const char* take_option(int& argc, char** argv,
+                               const std::string& name) {
+  for (int k = 1; k + 1 < argc; ++k) {
+    if (name != argv[k]) continue;
+    const char* value = argv[k + 1];
+    std::copy(argv + k + 2, argv + argc + 1, argv + k);
+    argc -= 2;
+    return value;
+  }
+  return nullptr;
+}
+
+// Tables with a rewind() member can step back through their history
+template <typename Table>
+void rewind(Table&, long) {}
+
+template <typename Table>
+auto rewind(Table& table, int) -> decltype(table.rewind()) {
+  return table.rewind();
+}
+
+template <typename Table>
+class Events {
+ public:
+  Events(GUI& gui, PixelSimulation<Table>& simulation)
+      : gui(gui), simulation(simulation) {}
+  void handle();
+  // pauses the simulation and shows the mouse cursor, or the reverse
+  void set_paused(bool);
+
+ private:
+  sf::Event event;
+  GUI& gui;
+  PixelSimulation<Table>& simulation;
+
+  void handle_keyboard();
+  void handle_mouse();
+  void view_changed();
+};
+
+inline GUI::GUI(unsigned int fps_max)
+    : window(sf::VideoMode(sf::VideoMode::getDesktopMode()),
+             "Conway's Game of Life", sf::Style::Fullscreen),
+      sprite(),
+      screen(window.getSize()),
+      fps_max(fps_max),
+      is_paused(false),
+      world(screen) {
+  window.setFramerateLimit(fps_max);
+  window.setMouseCursorVisible(false);
+  shared_view.store(view);
+  Profiler::get().name_thread("render");
+}
+
+inline void GUI::display(const PixelFrame* frame) {
+  ProfileScope scope("GUI::display");
+  if (frame) upload(*frame);
+  window.clear();
+  window.draw(sprite);
+  overlay.draw(window);
+  ProfileScope swap("window.display");
+  window.display();
+}
+
+// Patches only the dirty rectangles into the texture when the frame follows
+// the one already uploaded, and uploads everything otherwise.
+inline void GUI::upload(const PixelFrame& frame) {
+  ProfileScope scope("GUI::upload");
+  bool whole = !frame.has_dirty || frame.serial != shown_serial + 1;
+  if (texture.getSize() != sf::Vector2u(frame.width, frame.height)) {
+    texture.create(frame.width, frame.height);
+    sprite.setTexture(texture, true);
+    whole = true;
+  }
+  shown_serial = frame.has_dirty ? frame.serial : 0;
+  if (whole) {
+    texture.update(reinterpret_cast<const sf::Uint8*>(frame.pixels.data()));
+    return;
+  }
+  for (const sf::IntRect& rect : frame.dirty) {
+    patch.resize(rect.width * rect.height);
+    for (int y = 0; y < rect.height; ++y) {
+      const uint32_t* source =
+          &frame.pixels[rect.left + (rect.top + y) * frame.width];
+      std::copy(source, source + rect.width, &patch[y * rect.width]);
+    }
+    texture.update(reinterpret_cast<const sf::Uint8*>(patch.data()),
+                   rect.width, rect.height, rect.left, rect.top);
+  }
+}
+
+inline void GUI::show_world(sf::Vector2u size) {
+  world = size;
+  view.zoom = Viewport::kMinZoom;
+  while (view.zoom < Viewport::kMaxZoom &&
+         (view.scale(screen.x) < int(world.x) ||
+          view.scale(screen.y) < int(world.y))) {
+    ++view.zoom;
+  }
+  view.x = (int(world.x) - view.scale(screen.x)) / 2;
+  view.y = (int(world.y) - view.scale(screen.y)) / 2;
+  shared_view.store(view);
+}
+
+inline void GUI::zoom(int steps, int px, int py) {
+  const int x = view.cell_x(px), y = view.cell_y(py);
+  view.zoom = std::min(std::max(view.zoom + steps, Viewport::kMinZoom),
+                       Viewport::kMaxZoom);
+  view.x = x - view.scale(px);
+  view.y = y - view.scale(py);
+  shared_view.store(view);
+}
+
+inline void GUI::pan(int dx, int dy) {
+  // at least one cell per step when a cell is bigger than the step
+  auto cells = [this](int pixels) {
+    int n = view.scale(pixels);
+    return n ? n : (pixels > 0) - (pixels < 0);
+  };
+  view.x += cells(dx);
+  view.y += cells(dy);
+  shared_view.store(view);
+}
+
+template <typename Table>
+void Events<Table>::handle() {
+  ProfileScope scope("Events::handle");
+  while (gui.window.pollEvent(event)) {
+    switch (event.type) {
+      case sf::Event::Closed:
+        gui.window.close();
+        break;
+      case sf::Event::KeyPressed:
+        handle_keyboard();
+        break;
+      case sf::Event::MouseButtonPressed: {
+        handle_mouse();
+        break;
+      }
+      case sf::Event::MouseWheelScrolled:
+        if (event.mouseWheelScroll.delta == 0) break;
+        gui.zoom(event.mouseWheelScroll.delta > 0 ? -1 : 1,
+                 event.mouseWheelScroll.x, event.mouseWheelScroll.y);
+        view_changed();
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+template <typename Table>
+void Events<Table>::handle_keyboard() {
+  const int step_x = gui.screen.x / 8, step_y = gui.screen.y / 8;
+  const int centre_x = gui.screen.x / 2, centre_y = gui.screen.y / 2;
+  switch (event.key.code) {
+    case sf::Keyboard::Escape:
+      gui.window.close();
+      break;
+    case sf::Keyboard::N:
+      simulation.post([](Table& table) { table.randomize(); });
+      break;
+    case sf::Keyboard::C:
+      simulation.post([](Table& table) { table.clear(); });
+      break;
+    case sf::Keyboard::F:
+      static bool unlocked = false;
+      unlocked = !unlocked;
+      gui.window.setFramerateLimit(unlocked ? 0 : gui.fps_max);
+      break;
+    case sf::Keyboard::P:
+      set_paused(!gui.is_paused);
+      break;
+    case sf::Keyboard::Left:
+      gui.pan(-step_x, 0);
+      view_changed();
+      break;
+    case sf::Keyboard::Right:
+      gui.pan(step_x, 0);
+      view_changed();
+      break;
+    case sf::Keyboard::Up:
+      gui.pan(0, -step_y);
+      view_changed();
+      break;
+    case sf::Keyboard::Down:
+      gui.pan(0, step_y);
+      view_changed();
+      break;
+    case sf::Keyboard::Add:
+    case sf::Keyboard::Equal:
+      gui.zoom(-1, centre_x, centre_y);
+      view_changed();
+      break;
+    case sf::Keyboard::Subtract:
+    case sf::Keyboard::Hyphen:
+      gui.zoom(1, centre_x, centre_y);
+      view_changed();
+      break;
+    case sf::Keyboard::Home:
+      gui.show_world(gui.world);
+      view_changed();
+      break;
+    case sf::Keyboard::R:
+      set_paused(true);
+      simulation.post([](Table& table) { rewind(table, 0); });
+      break;
+    case sf::Keyboard::S:
+      simulation.post([](Table& table) {
+        try {
+          save_pattern(table, "saved.rle");
+        } catch (const std::exception& error) {
+          std::cerr << error.what() << '\n';
+        }
+      });
+      break;
+    case sf::Keyboard::O:
+      gui.overlay.toggle();
+      break;
+    case sf::Keyboard::T:
+      if (!Profiler::get().write_chrome_trace("trace.json")) {
+        std::cerr << "cannot write trace.json\n";
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+template <typename Table>
+void Events<Table>::set_paused(bool paused) {
+  gui.is_paused = paused;
+  gui.window.setMouseCursorVisible(paused);
+  simulation.set_paused(paused);
+}
+
+template <typename Table>
+void Events<Table>::handle_mouse() {
+  sf::Vector2i p = sf::Mouse::getPosition() - gui.window.getPosition();
+  int x = gui.view.cell_x(p.x);
+  int y = gui.view.cell_y(p.y);
+  simulation.post([x, y](Table& table) {
+    if (x < 0 || x >= table.width || y < 0 || y >= table.height) return;
+    table.set_state(x, y, !table.get_state(x, y));
+  });
+}
+
+// an empty command makes even a paused simulation publish a new frame
+template <typename Table>
+void Events<Table>::view_changed() {
+  simulation.post([](Table&) {});
+}
@@ -0,0 +1,427 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <vector>
+
+// Gosper's HashLife on an unbounded plane. The universe is a quadtree of
+// hash-consed nodes: equal subtrees are one node, and every node of level L
+// (2^L x 2^L cells) memoizes its centre advanced by
+// 2^min(step_log2, L - 2) generations, so update() jumps 2^step_log2
+// generations at a time. The window [0, width) x [0, height) is what the GUI
+// shows and what randomize() fills; cells outside it keep evolving.
+//
+// Nodes live in a pool capped at memory_limit_mb; once update() leaves more
+// nodes than that, everything unreachable from the root is collected.
+class HashLife {
+ public:
+  HashLife(const sf::Vector2u&, int step_log2 = 0,
+           size_t memory_limit_mb = 256);
+  HashLife(const HashLife&) = delete;
+  HashLife& operator=(const HashLife&) = delete;
+  bool get_state(int, int) const;
+  void set_state(int, int, bool);
+  void clear();
+  void randomize();
+  void randomize(uint64_t seed);
+  void update();
+
+  void set_step(int log2);
+  int get_step() const { return step_log2; }
+  uint64_t get_generation() const { return generation; }
+  uint64_t get_population() const { return root->population; }
+  size_t get_node_count() const { return node_count; }
+  // calls f(i, j) for every live cell of the window
+  template <typename F>
+  void for_each_alive(F f) const {
+    for_each_alive_in(0, 0, width, height, f);
+  }
+  // the same for the cells of the window in [x0, x1) x [y0, y1); subtrees
+  // outside it are not entered
+  template <typename F>
+  void for_each_alive_in(int x0, int y0, int x1, int y1, F f) const;
+
+  const int width;
+  const int height;
+
+ private:
+  struct Node {
+    Node* nw;
+    Node* ne;
+    Node* sw;
+    Node* se;
+    Node* result;  // memoized centre after 2^min(step_log2, level - 2) gens
+    Node* next;    // hash chain or free list
+    uint64_t population;
+    int level;
+    bool marked;
+  };
+  static constexpr size_t kBlockNodes = 1 << 16;
+
+  std::vector<std::unique_ptr<Node[]>> blocks;
+  Node* free_nodes = nullptr;
+  std::vector<Node*> buckets;
+  size_t node_count = 0;
+  const size_t max_nodes;
+  Node leaves[2];
+  std::vector<Node*> empties;  // empties[level]
+  Node* root;
+  int min_level;  // smallest root that still contains the window
+  int step_log2;
+  uint64_t generation = 0;
+
+  Node* leaf(bool state) { return &leaves[state]; }
+  Node* empty(int level);
+  Node* join(Node*, Node*, Node*, Node*);
+  Node*& bucket(const Node*, const Node*, const Node*, const Node*);
+  Node* centre(Node*);
+  Node* expand(Node*);
+  bool is_centred(const Node*) const;
+  Node* step(Node*);
+  Node* step_base(Node*);
+  Node* set_cell(Node*, int64_t, int64_t, bool);
+  Node* build(const std::vector<uint64_t>&, int, int, int);
+  void fill_random(std::mt19937_64&);
+  void clear_results();
+  void collect_garbage();
+  static void mark(Node*);
+  // calls f for the live cells of node, whose corner is at (x, y), inside
+  // the clip [x0, x1) x [y0, y1)
+  struct Clip {
+    int64_t x0, y0, x1, y1;
+  };
+  template <typename F>
+  static void visit(const Node*, int64_t x, int64_t y, const Clip&, F&);
+};
+
+inline HashLife::HashLife(const sf::Vector2u& size, int step_log2,
+                          size_t memory_limit_mb)
+    : width(size.x),
+      height(size.y),
+      buckets(1 << 16),
+      max_nodes((memory_limit_mb << 20) / sizeof(Node)),
+      leaves{{nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, 0, 0, true},
+             {nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, 1, 0, true}},
+      step_log2(step_log2) {
+  min_level = 2;
+  while ((int64_t(1) << (min_level - 1)) < std::max(width, height)) {
+    ++min_level;
+  }
+  randomize();
+}
+
+inline bool HashLife::get_state(int i, int j) const {
+  const Node* node = root;
+  int64_t half = int64_t(1) << (node->level - 1);
+  int64_t x = i + half, y = j + half;
+  if (x < 0 || y < 0 || x >= 2 * half || y >= 2 * half) return false;
+  while (node->level > 0 && node->population != 0) {
+    half = int64_t(1) << (node->level - 1);
+    bool east = x >= half, south = y >= half;
+    node = south ? (east ? node->se : node->sw) : (east ? node->ne : node->nw);
+    x -= east ? half : 0;
+    y -= south ? half : 0;
+  }
+  return node->population != 0;
+}
+
+inline void HashLife::set_state(int i, int j, bool state) {
+  while (true) {
+    int64_t half = int64_t(1) << (root->level - 1);
+    if (i >= -half && j >= -half && i < half && j < half) {
+      root = set_cell(root, i + half, j + half, state);
+      return;
+    }
+    root = expand(root);
+  }
+}
+
+inline void HashLife::clear() {
+  root = empty(min_level);
+  generation = 0;
+  collect_garbage();
+}
+
+// same bit stream and cell order as the ImageCellTable::randomize()
+inline void HashLife::randomize() {
+  static std::mt19937_64 rnd;
+  fill_random(rnd);
+}
+
+inline void HashLife::randomize(uint64_t seed) {
+  std::mt19937_64 rnd(seed);
+  fill_random(rnd);
+}
+
+inline void HashLife::fill_random(std::mt19937_64& rnd) {
+  const int words_per_row = (width + 63) / 64;
+  std::vector<uint64_t> bits(words_per_row * height);
+  for (auto& word : bits) word = rnd();
+  // the window is the south-east quadrant of a root centred on the origin
+  Node* window = build(bits, 0, 0, min_level - 1);
+  Node* e = empty(min_level - 1);
+  root = join(e, e, e, window);
+  generation = 0;
+  collect_garbage();
+}
+
+inline void HashLife::update() {
+  // after 2^step_log2 generations the pattern grows by at most that many
+  // cells per side, which the extra level of empty border absorbs
+  while (root->level < step_log2 + 2 || !is_centred(root)) {
+    root = expand(root);
+  }
+  root = step(expand(root));
+  while (root->level > min_level && is_centred(root)) root = centre(root);
+  generation += uint64_t(1) << step_log2;
+  if (node_count > max_nodes) collect_garbage();
+}
+
+// memoized results are only valid for the step they were computed with
+inline void HashLife::set_step(int log2) {
+  if (log2 == step_log2) return;
+  step_log2 = log2;
+  clear_results();
+}
+
+template <typename F>
+void HashLife::for_each_alive_in(int x0, int y0, int x1, int y1, F f) const {
+  const Clip clip = {std::max(x0, 0), std::max(y0, 0), std::min(x1, width),
+                     std::min(y1, height)};
+  int64_t half = int64_t(1) << (root->level - 1);
+  visit(root, -half, -half, clip, f);
+}
+
+template <typename F>
+void HashLife::visit(const Node* node, int64_t x, int64_t y, const Clip& clip,
+                     F& f) {
+  int64_t size = int64_t(1) << node->level;
+  if (node->population == 0 || x >= clip.x1 || y >= clip.y1 ||
+      x + size <= clip.x0 || y + size <= clip.y0) {
+    return;
+  }
+  if (node->level == 0) {
+    f(static_cast<int>(x), static_cast<int>(y));
+    return;
+  }
+  int64_t half = size / 2;
+  visit(node->nw, x, y, clip, f);
+  visit(node->ne, x + half, y, clip, f);
+  visit(node->sw, x, y + half, clip, f);
+  visit(node->se, x + half, y + half, clip, f);
+}
+
+inline HashLife::Node* HashLife::empty(int level) {
+  while (static_cast<int>(empties.size()) <= level) {
+    if (empties.empty()) {
+      empties.push_back(leaf(false));
+    } else {
+      Node* e = empties.back();
+      empties.push_back(join(e, e, e, e));
+    }
+  }
+  return empties[level];
+}
+
+inline HashLife::Node*& HashLife::bucket(const Node* nw, const Node* ne,
+                                         const Node* sw, const Node* se) {
+  size_t hash = reinterpret_cast<uintptr_t>(nw) * 0x9E3779B97F4A7C15ull;
+  hash = (hash ^ reinterpret_cast<uintptr_t>(ne)) * 0xBF58476D1CE4E5B9ull;
+  hash = (hash ^ reinterpret_cast<uintptr_t>(sw)) * 0x94D049BB133111EBull;
+  hash = (hash ^ reinterpret_cast<uintptr_t>(se)) * 0x9E3779B97F4A7C15ull;
+  return buckets[(hash ^ (hash >> 29)) & (buckets.size() - 1)];
+}
+
+// returns the canonical node with these children
+inline HashLife::Node* HashLife::join(Node* nw, Node* ne, Node* sw, Node* se) {
+  Node*& head = bucket(nw, ne, sw, se);
+  for (Node* node = head; node; node = node->next) {
+    if (node->nw == nw && node->ne == ne && node->sw == sw && node->se == se) {
+      return node;
+    }
+  }
+  if (!free_nodes) {
+    blocks.emplace_back(new Node[kBlockNodes]);
+    for (size_t i = 0; i != kBlockNodes; ++i) {
+      blocks.back()[i].next = free_nodes;
+      free_nodes = &blocks.back()[i];
+    }
+  }
+  Node* node = free_nodes;
+  free_nodes = node->next;
+  *node = {nw, ne, sw, se, nullptr, head,
+           nw->population + ne->population + sw->population + se->population,
+           nw->level + 1, false};
+  head = node;
+  if (++node_count > buckets.size()) {
+    std::vector<Node*> old(buckets.size() * 2);
+    old.swap(buckets);
+    for (Node* chain : old) {
+      while (chain) {
+        Node* moved = chain;
+        chain = chain->next;
+        Node*& target = bucket(moved->nw, moved->ne, moved->sw, moved->se);
+        moved->next = target;
+        target = moved;
+      }
+    }
+  }
+  return node;
+}
+
+// the level L - 1 node in the middle of a level L node
+inline HashLife::Node* HashLife::centre(Node* node) {
+  return join(node->nw->se, node->ne->sw, node->sw->ne, node->se->nw);
+}
+
+// the level L + 1 node with this node in the middle and empty border
+inline HashLife::Node* HashLife::expand(Node* node) {
+  Node* e = empty(node->level - 1);
+  return join(join(e, e, e, node->nw), join(e, e, node->ne, e),
+              join(e, node->sw, e, e), join(node->se, e, e, e));
+}
+
+inline bool HashLife::is_centred(const Node* node) const {
+  return node->nw->se->population + node->ne->sw->population +
+             node->sw->ne->population + node->se->nw->population ==
+         node->population;
+}
+
+// centre of a level L >= 2 node after 2^min(step_log2, L - 2) generations
+inline HashLife::Node* HashLife::step(Node* node) {
+  if (node->population == 0) return empty(node->level - 1);
+  if (node->result) return node->result;
+  if (node->level == 2) return node->result = step_base(node);
+  // nine overlapping level L - 1 subnodes
+  Node* n00 = node->nw;
+  Node* n01 = join(node->nw->ne, node->ne->nw, node->nw->se, node->ne->sw);
+  Node* n02 = node->ne;
+  Node* n10 = join(node->nw->sw, node->nw->se, node->sw->nw, node->sw->ne);
+  Node* n11 = join(node->nw->se, node->ne->sw, node->sw->ne, node->se->nw);
+  Node* n12 = join(node->ne->sw, node->ne->se, node->se->nw, node->se->ne);
+  Node* n20 = node->sw;
+  Node* n21 = join(node->sw->ne, node->se->nw, node->sw->se, node->se->sw);
+  Node* n22 = node->se;
+  // at full speed both halves advance 2^(L - 3) generations, otherwise the
+  // first half only recentres and the second one does the whole step
+  const bool full = step_log2 >= node->level - 2;
+  auto first = [&](Node* sub) { return full ? step(sub) : centre(sub); };
+  Node* r00 = first(n00);
+  Node* r01 = first(n01);
+  Node* r02 = first(n02);
+  Node* r10 = first(n10);
+  Node* r11 = first(n11);
+  Node* r12 = first(n12);
+  Node* r20 = first(n20);
+  Node* r21 = first(n21);
+  Node* r22 = first(n22);
+  Node* result = join(step(join(r00, r01, r10, r11)),
+                      step(join(r01, r02, r11, r12)),
+                      step(join(r10, r11, r20, r21)),
+                      step(join(r11, r12, r21, r22)));
+  return node->result = result;
+}
+
+// one generation of the 2x2 centre of a 4x4 node
+inline HashLife::Node* HashLife::step_base(Node* node) {
+  bool cells[4][4];
+  Node* quadrants[2][2] = {{node->nw, node->ne}, {node->sw, node->se}};
+  for (int y = 0; y < 4; ++y) {
+    for (int x = 0; x < 4; ++x) {
+      Node* q = quadrants[y / 2][x / 2];
+      Node* children[2][2] = {{q->nw, q->ne}, {q->sw, q->se}};
+      cells[y][x] = children[y % 2][x % 2]->population != 0;
+    }
+  }
+  Node* next[2][2];
+  for (int y = 1; y < 3; ++y) {
+    for (int x = 1; x < 3; ++x) {
+      int neighbors = 0;
+      for (int dy = -1; dy <= 1; ++dy) {
+        for (int dx = -1; dx <= 1; ++dx) {
+          neighbors += (dx || dy) && cells[y + dy][x + dx];
+        }
+      }
+      next[y - 1][x - 1] =
+          leaf(neighbors == 3 || (cells[y][x] && neighbors == 2));
+    }
+  }
+  return join(next[0][0], next[0][1], next[1][0], next[1][1]);
+}
+
+// (x, y) are relative to the north-west corner of the node
+inline HashLife::Node* HashLife::set_cell(Node* node, int64_t x, int64_t y,
+                                          bool state) {
+  if (node->level == 0) return leaf(state);
+  int64_t half = int64_t(1) << (node->level - 1);
+  bool east = x >= half, south = y >= half;
+  x -= east ? half : 0;
+  y -= south ? half : 0;
+  Node* nw = node->nw;
+  Node* ne = node->ne;
+  Node* sw = node->sw;
+  Node* se = node->se;
+  Node*& child = south ? (east ? se : sw) : (east ? ne : nw);
+  child = set_cell(child, x, y, state);
+  return join(nw, ne, sw, se);
+}
+
+// quadtree of the window cells in [x, x + 2^level) x [y, y + 2^level)
+inline HashLife::Node* HashLife::build(const std::vector<uint64_t>& bits,
+                                       int x, int y, int level) {
+  if (x >= width || y >= height) return empty(level);
+  if (level == 0) {
+    const int words_per_row = (width + 63) / 64;
+    return leaf((bits[y * words_per_row + x / 64] >> (x % 64)) & 1);
+  }
+  int half = 1 << (level - 1);
+  return join(build(bits, x, y, level - 1), build(bits, x + half, y, level - 1),
+              build(bits, x, y + half, level - 1),
+              build(bits, x + half, y + half, level - 1));
+}
+
+inline void HashLife::clear_results() {
+  for (Node* head : buckets) {
+    for (Node* node = head; node; node = node->next) node->result = nullptr;
+  }
+}
+
+inline void HashLife::mark(Node* node) {
+  if (node->marked) return;
+  node->marked = true;
+  mark(node->nw);
+  mark(node->ne);
+  mark(node->sw);
+  mark(node->se);
+}
+
+// Keeps the root and the empty nodes with everything below them. Memoized
+// results that point to collected nodes are forgotten.
+inline void HashLife::collect_garbage() {
+  mark(root);
+  for (Node* e : empties) mark(e);
+  for (Node* head : buckets) {
+    for (Node* node = head; node; node = node->next) {
+      if (node->marked && node->result && !node->result->marked) {
+        node->result = nullptr;
+      }
+    }
+  }
+  for (Node*& head : buckets) {
+    Node** link = &head;
+    while (Node* node = *link) {
+      if (node->marked) {
+        node->marked = false;
+        link = &node->next;
+      } else {
+        *link = node->next;
+        node->next = free_nodes;
+        free_nodes = node;
+        --node_count;
+      }
+    }
+  }
+}
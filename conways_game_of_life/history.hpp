@@ -0,0 +1,141 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <utility>
+#include <vector>
+
+// Bounded record of past generations of a bit-packed table, newest last.
+// Every keyframe_interval-th entry is a keyframe holding the whole state;
+// the entries in between hold the XOR with the generation before. Both are
+// stored sparsely: each non-zero word is written as the varint gap to the
+// previous one, a mask of its non-zero bytes and those bytes, so a
+// generation where few cells changed costs a few bytes per changed word.
+// When the entries outgrow the byte budget, the oldest keyframe is dropped
+// together with the deltas that depend on it.
+class History {
+ public:
+  using Word = uint64_t;
+
+  explicit History(size_t budget_bytes, int keyframe_interval = 64);
+
+  // appends the state after a generation (or any other change)
+  void record(const std::vector<Word>& cells);
+  // forgets the newest state and writes the one before into cells; false if
+  // there is nothing older left
+  bool step_back(std::vector<Word>& cells);
+
+  size_t get_generations() const { return entries.size(); }
+  size_t get_bytes() const { return bytes; }
+
+ private:
+  struct Entry {
+    bool keyframe;
+    std::vector<uint8_t> data;
+  };
+
+  const size_t budget;
+  const int keyframe_interval;
+  std::deque<Entry> entries;
+  size_t bytes = 0;
+  int since_keyframe = 0;
+  std::vector<Word> last;  // state of the newest entry
+
+  static void encode(const std::vector<Word>& cells,
+                     const std::vector<Word>* base, std::vector<uint8_t>&);
+  static void apply(const std::vector<uint8_t>&, std::vector<Word>& cells);
+  void trim();
+};
+
+inline History::History(size_t budget_bytes, int keyframe_interval)
+    : budget(budget_bytes), keyframe_interval(keyframe_interval) {}
+
+inline void History::record(const std::vector<Word>& cells) {
+  if (last.size() != cells.size()) {
+    entries.clear();
+    bytes = 0;
+    since_keyframe = 0;
+  }
+  Entry entry;
+  entry.keyframe = since_keyframe == 0;
+  encode(cells, entry.keyframe ? nullptr : &last, entry.data);
+  since_keyframe = (since_keyframe + 1) % keyframe_interval;
+  bytes += entry.data.size();
+  entries.push_back(std::move(entry));
+  last = cells;
+  trim();
+}
+
+// rebuilds the new newest state from its keyframe forward
+inline bool History::step_back(std::vector<Word>& cells) {
+  if (entries.size() < 2) return false;
+  bytes -= entries.back().data.size();
+  entries.pop_back();
+  size_t key = entries.size() - 1;
+  while (!entries[key].keyframe) --key;
+  std::fill(last.begin(), last.end(), Word());
+  for (size_t i = key; i < entries.size(); ++i) apply(entries[i].data, last);
+  since_keyframe = (entries.size() - key) % keyframe_interval;
+  cells = last;
+  return true;
+}
+
+inline void History::encode(const std::vector<Word>& cells,
+                            const std::vector<Word>* base,
+                            std::vector<uint8_t>& out) {
+  size_t next = 0;  // index right after the previous non-zero word
+  for (size_t i = 0; i < cells.size(); ++i) {
+    const Word word = base ? cells[i] ^ (*base)[i] : cells[i];
+    if (!word) continue;
+    for (size_t gap = i - next; ; gap >>= 7) {
+      if (gap < 0x80) {
+        out.push_back(gap);
+        break;
+      }
+      out.push_back(0x80 | (gap & 0x7F));
+    }
+    next = i + 1;
+    uint8_t mask = 0;
+    for (int b = 0; b < 8; ++b) {
+      if ((word >> (8 * b)) & 0xFF) mask |= 1 << b;
+    }
+    out.push_back(mask);
+    for (int b = 0; b < 8; ++b) {
+      if (mask >> b & 1) out.push_back(word >> (8 * b));
+    }
+  }
+}
+
+inline void History::apply(const std::vector<uint8_t>& data,
+                           std::vector<Word>& cells) {
+  size_t i = 0;
+  for (const uint8_t* p = data.data(); p < data.data() + data.size();) {
+    size_t gap = 0;
+    for (int shift = 0; ; shift += 7) {
+      gap |= size_t(*p & 0x7F) << shift;
+      if (!(*p++ & 0x80)) break;
+    }
+    i += gap;
+    const uint8_t mask = *p++;
+    Word word = 0;
+    for (int b = 0; b < 8; ++b) {
+      if (mask >> b & 1) word |= Word(*p++) << (8 * b);
+    }
+    cells[i++] ^= word;
+  }
+}
+
+// drops whole keyframe groups from the front, but never the newest one
+inline void History::trim() {
+  while (bytes > budget) {
+    size_t end = 1;
+    while (end < entries.size() && !entries[end].keyframe) ++end;
+    if (end == entries.size()) return;
+    for (size_t i = 0; i < end; ++i) {
+      bytes -= entries.front().data.size();
+      entries.pop_front();
+    }
+  }
+}
@@ -0,0 +1,364 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "rule.hpp"
+
+// Toroidal table that lives directly in the pixels of an sf::Image, one
+// 4-byte pixel per cell. Changed cells are tracked per 32x32 tile so the
+// renderer can re-upload only the parts of the image that differ.
+//
+// Any outer-totalistic rule can be run. Dying states of Generations rules
+// are shades of red whose red byte is 255 - state, so the pixel still
+// tells the state.
+//
+// With a time block of k > 1, update() advances k generations in one pass
+// over kTimeTile x kTimeTile tiles, each copied with a k-cell halo into a
+// byte buffer small enough to stay in L2 while all k steps run on it.
+class ImageCellTable {
+ public:
+  static constexpr int kDirtyTile = 32;
+  static constexpr int kTimeTile = 128;
+  static constexpr uint32_t kAlive = 0xFFFFFFFF;
+  static constexpr uint32_t kDead = 0xFF000000;
+
+  ImageCellTable(const sf::Vector2u&);
+  const sf::Image& get_image() const { return image; }
+  // appends the rectangles changed since the previous call and forgets them
+  void take_dirty_rects(std::vector<sf::IntRect>&);
+  bool get_state(int, int) const;
+  void set_state(int, int, bool);
+  void clear();
+  void randomize();
+  void randomize(uint64_t seed);
+  void update();
+  void set_rule(const Rule&);
+  const Rule& get_rule() const { return rule; }
+  // generations advanced by each update()
+  void set_time_block(int k) { time_block = std::max(k, 1); }
+  int get_time_block() const { return time_block; }
+  // XOR of a random key per (cell, state) over every cell that is not dead,
+  // updated by each pixel write, so equal boards have equal hashes
+  uint64_t get_hash() const { return hash; }
+
+  // calls f(i, j) for every live cell
+  template <typename F>
+  void for_each_alive(F f) const {
+    for_each_alive_in(0, 0, width, height, f);
+  }
+  // the same for the cells in [x0, x1) x [y0, y1), visiting only those
+  template <typename F>
+  void for_each_alive_in(int x0, int y0, int x1, int y1, F f) const;
+
+  const int width;
+  const int height;
+
+ private:
+  void fill_random(std::mt19937_64&);
+  sf::Image image;
+  uint32_t* image_ptr;
+  std::vector<uint8_t> neighbors;
+  const int tiles_x;
+  const int tiles_y;
+  std::vector<uint8_t> dirty;  // one flag per tile
+  bool all_dirty = true;
+  Rule rule;
+  std::vector<uint32_t> colors;  // pixel of every state
+  int time_block = 1;
+  std::vector<uint8_t> blocked;  // states after a blocked update
+  std::vector<uint8_t> tile[2];  // tile plus halo, two generations
+  uint64_t hash = 0;
+
+  static int state_of(uint32_t pixel) {
+    const uint8_t red = pixel & 0xFF;
+    return red == 0 ? 0 : (red == 255 ? 1 : 255 - red);
+  }
+  // splitmix64 finaliser; dead cells have no key
+  static uint64_t cell_key(int index, int state) {
+    if (state == 0) return 0;
+    uint64_t z = (uint64_t(index) << 8 | state) + 0x9E3779B97F4A7C15;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EB;
+    return z ^ (z >> 31);
+  }
+  void fix_neighbors(int, int);
+  void set_pixel(int, int, uint32_t);
+  template <typename R>
+  void apply_rule(R);
+  void apply_generations();
+  void update_blocked();
+  template <typename R>
+  void step_tile(R, int size_x, int margin, int rows);
+  void step_tile_generations(int size_x, int margin, int rows);
+};
+
+inline ImageCellTable::ImageCellTable(
+    const sf::Vector2u& size) : width(size.x),
+                                height(size.y),
+                                neighbors(size.x * size.y),
+                                tiles_x((size.x + kDirtyTile - 1) / kDirtyTile),
+                                tiles_y((size.y + kDirtyTile - 1) / kDirtyTile),
+                                dirty(tiles_x * tiles_y),
+                                colors{kDead, kAlive} {
+  image.create(size.x, size.y);
+  image_ptr = reinterpret_cast<uint32_t*>(
+      const_cast<sf::Uint8*>(image.getPixelsPtr()));
+  randomize();
+}
+
+inline bool ImageCellTable::get_state(int i, int j) const {
+  //return image.getPixel(i, j) == sf::Color::White;
+  return image_ptr[i + j * width] == kAlive;
+}
+
+inline void ImageCellTable::set_state(int i, int j, bool state) {
+  //image.setPixel(i, j, (state ? sf::Color::White : sf::Color::Black));
+  set_pixel(i, j, state ? kAlive : kDead);
+}
+
+inline void ImageCellTable::set_pixel(int i, int j, uint32_t color) {
+  const int index = i + j * width;
+  uint32_t& pixel = image_ptr[index];
+  if (pixel == color) return;
+  hash ^= cell_key(index, state_of(pixel)) ^ cell_key(index, state_of(color));
+  pixel = color;
+  dirty[i / kDirtyTile + j / kDirtyTile * tiles_x] = 1;
+}
+
+// fills in place: image.create() would move the pixels away from image_ptr
+inline void ImageCellTable::clear() {
+  std::fill(image_ptr, image_ptr + width * height, kDead);
+  all_dirty = true;
+  hash = 0;
+}
+
+inline void ImageCellTable::randomize() {
+  static std::mt19937_64 rnd;
+  fill_random(rnd);
+}
+
+inline void ImageCellTable::randomize(uint64_t seed) {
+  std::mt19937_64 rnd(seed);
+  fill_random(rnd);
+}
+
+inline void ImageCellTable::fill_random(std::mt19937_64& rnd) {
+  uint64_t num = 0;
+  for (int j = 0; j < height; ++j) {
+    for (int i = 0; i < width; ++i, num >>= 1) {
+      if ((i & 0x3F) == 0) num = rnd();
+      image_ptr[i + j * width] = num & 1 ? kAlive : kDead;
+    }
+  }
+  all_dirty = true;
+  hash = 0;
+  for (int index = 0; index < width * height; ++index) {
+    hash ^= cell_key(index, state_of(image_ptr[index]));
+  }
+}
+
+inline void ImageCellTable::update() {
+  if (time_block > 1) {
+    update_blocked();
+    return;
+  }
+  std::fill(neighbors.begin(), neighbors.end(), uint8_t());
+  for (int j = 0; j < height; ++j) {
+    for (int i = 0; i < width; ++i) {
+      if (get_state(i, j)) fix_neighbors(i, j);
+    }
+  }
+  if (rule.states > 2) {
+    apply_generations();
+  } else {
+    dispatch_rule(rule, [this](auto fixed) { apply_rule(fixed); });
+  }
+}
+
+inline void ImageCellTable::set_rule(const Rule& next) {
+  rule = next;
+  colors.assign({kDead, kAlive});
+  for (int state = 2; state < rule.states; ++state) {
+    const uint32_t fade = 0xC0 * (rule.states - state) / rule.states;
+    colors.push_back(kDead | fade << 16 | fade << 8 | (255 - state));
+  }
+}
+
+// A cell is alive next if bit `neighbours` of the survive mask (live cells)
+// or of the birth mask (dead cells) is set; no branch depends on the count.
+template <typename R>
+void ImageCellTable::apply_rule(R rule) {
+  for (int j = 0; j < height; ++j) {
+    for (int i = 0; i < width; ++i) {
+      const int index = i + j * width;
+      const unsigned mask = get_state(i, j) ? rule.survive : rule.birth;
+      set_pixel(i, j, (mask >> neighbors[index]) & 1 ? kAlive : kDead);
+    }
+  }
+}
+
+inline void ImageCellTable::apply_generations() {
+  for (int j = 0; j < height; ++j) {
+    for (int i = 0; i < width; ++i) {
+      const int index = i + j * width;
+      const int state = state_of(image_ptr[index]);
+      int next;
+      if (state == 0) {
+        next = (rule.birth >> neighbors[index]) & 1;
+      } else if (state == 1) {
+        next = (rule.survive >> neighbors[index]) & 1 ? 1 : 2;
+      } else {
+        next = state + 1 == rule.states ? 0 : state + 1;
+      }
+      set_pixel(i, j, colors[next]);
+    }
+  }
+}
+
+// The tile and its halo wrap around the torus. Generation g is valid on the
+// region g cells inside the buffer's border, so after k generations exactly
+// the tile is left, equal to what k single updates would give.
+inline void ImageCellTable::update_blocked() {
+  const int k = time_block;
+  const bool two_state = rule.states == 2;
+  blocked.resize(width * height);
+  for (int y0 = 0; y0 < height; y0 += kTimeTile) {
+    for (int x0 = 0; x0 < width; x0 += kTimeTile) {
+      const int tile_x = std::min(kTimeTile, width - x0);
+      const int tile_y = std::min(kTimeTile, height - y0);
+      const int size_x = tile_x + 2 * k, size_y = tile_y + 2 * k;
+      tile[0].resize(size_x * size_y);
+      tile[1].resize(size_x * size_y);
+      for (int r = 0; r < size_y; ++r) {
+        const int j = ((y0 - k + r) % height + height) % height;
+        const uint32_t* row = image_ptr + j * width;
+        int i = ((x0 - k) % width + width) % width;
+        for (int c = 0; c < size_x; ++c) {
+          // two-state rules see leftover dying cells as dead
+          const int state = state_of(row[i]);
+          tile[0][r * size_x + c] = two_state ? state == 1 : state;
+          if (++i == width) i = 0;
+        }
+      }
+      for (int g = 1; g <= k; ++g) {
+        if (!two_state) {
+          step_tile_generations(size_x, g, size_y - 2 * g);
+        } else {
+          dispatch_rule(rule, [&](auto fixed) {
+            step_tile(fixed, size_x, g, size_y - 2 * g);
+          });
+        }
+        tile[0].swap(tile[1]);
+      }
+      for (int r = 0; r < tile_y; ++r) {
+        std::copy_n(&tile[0][(r + k) * size_x + k], tile_x,
+                    &blocked[(y0 + r) * width + x0]);
+      }
+    }
+  }
+  for (int j = 0; j < height; ++j) {
+    for (int i = 0; i < width; ++i) {
+      set_pixel(i, j, colors[blocked[i + j * width]]);
+    }
+  }
+}
+
+// computes tile[1] from tile[0] on the rows and columns [margin, size -
+// margin) of the buffer, with the same mask formula as apply_rule()
+template <typename R>
+void ImageCellTable::step_tile(R rule, int size_x, int margin, int rows) {
+  const uint8_t* in = tile[0].data();
+  uint8_t* out = tile[1].data();
+  for (int r = margin; r < margin + rows; ++r) {
+    const uint8_t* up = in + (r - 1) * size_x;
+    const uint8_t* mid = in + r * size_x;
+    const uint8_t* down = in + (r + 1) * size_x;
+    for (int c = margin; c < size_x - margin; ++c) {
+      const int n = up[c - 1] + up[c] + up[c + 1] + mid[c - 1] + mid[c + 1] +
+                    down[c - 1] + down[c] + down[c + 1];
+      const unsigned mask = mid[c] ? rule.survive : rule.birth;
+      out[r * size_x + c] = (mask >> n) & 1;
+    }
+  }
+}
+
+inline void ImageCellTable::step_tile_generations(int size_x, int margin,
+                                                  int rows) {
+  const uint8_t* in = tile[0].data();
+  uint8_t* out = tile[1].data();
+  for (int r = margin; r < margin + rows; ++r) {
+    for (int c = margin; c < size_x - margin; ++c) {
+      int n = 0;
+      for (int dr = -1; dr <= 1; ++dr) {
+        for (int dc = -1; dc <= 1; ++dc) {
+          n += (dr || dc) && in[(r + dr) * size_x + c + dc] == 1;
+        }
+      }
+      const int state = in[r * size_x + c];
+      int next;
+      if (state == 0) {
+        next = (rule.birth >> n) & 1;
+      } else if (state == 1) {
+        next = (rule.survive >> n) & 1 ? 1 : 2;
+      } else {
+        next = state + 1 == rule.states ? 0 : state + 1;
+      }
+      out[r * size_x + c] = next;
+    }
+  }
+}
+
+template <typename F>
+void ImageCellTable::for_each_alive_in(int x0, int y0, int x1, int y1,
+                                       F f) const {
+  x0 = std::max(x0, 0), x1 = std::min(x1, width);
+  y0 = std::max(y0, 0), y1 = std::min(y1, height);
+  for (int j = y0; j < y1; ++j) {
+    for (int i = x0; i < x1; ++i) {
+      if (get_state(i, j)) f(i, j);
+    }
+  }
+}
+
+inline void ImageCellTable::fix_neighbors(int i, int j) {
+  const int offsets[8][2] = {
+      {-1, -1}, {0, -1}, {1, -1}, {-1, 0}, {1, 0}, {-1, 1}, {0, 1}, {1, 1}};
+  for (auto offset : offsets) {
+    int io = i + offset[0];
+    int jo = j + offset[1];
+    if (io < 0) io += width;
+    if (io >= width) io -= width;
+    if (jo < 0) jo += height;
+    if (jo >= height) jo -= height;
+    ++neighbors[io + jo * width];
+  }
+}
+
+// Runs of dirty tiles in a tile row become one rectangle each.
+inline void ImageCellTable::take_dirty_rects(std::vector<sf::IntRect>& rects) {
+  if (all_dirty) {
+    rects.emplace_back(0, 0, width, height);
+    std::fill(dirty.begin(), dirty.end(), uint8_t());
+    all_dirty = false;
+    return;
+  }
+  for (int ty = 0; ty < tiles_y; ++ty) {
+    uint8_t* row = &dirty[ty * tiles_x];
+    for (int tx = 0; tx < tiles_x;) {
+      if (!row[tx]) {
+        ++tx;
+        continue;
+      }
+      int end = tx;
+      while (end < tiles_x && row[end]) row[end++] = 0;
+      const int x = tx * kDirtyTile, y = ty * kDirtyTile;
+      rects.emplace_back(x, y, std::min(end * kDirtyTile, width) - x,
+                         std::min(y + kDirtyTile, height) - y);
+      tx = end;
+    }
+  }
+}
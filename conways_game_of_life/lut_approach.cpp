@@ -0,0 +1,36 @@
+#include <SFML/Graphics.hpp>
+#include <chrono>
+#include <iostream>
+
+#include "game_of_life.hpp"
+#include "lut_cell_table.hpp"
+
+int main(int argc, char** argv) {
+  const unsigned int fps_max = 0;
+  GUI gui(fps_max);
+  LutCellTable table(world_size(argc, argv, gui));
+  try {
+    if (const char* path = pattern_path(argc, argv)) {
+      table.set_rule(Rule::parse(load_pattern(table, path)));
+    }
+  } catch (const std::exception& error) {
+    std::cerr << error.what() << '\n';
+    return 1;
+  }
+  gui.show_world(sf::Vector2u(table.width, table.height));
+  PixelSimulation<LutCellTable> simulation(
+      table, capture_view<LutCellTable>(gui));
+  Events<LutCellTable> events(gui, simulation);
+
+  int frame_counter = 0;
+  while (gui.window.isOpen() && ++frame_counter <= 40) {
+    gui.display(simulation.acquire());
+    events.handle();
+  }
+  auto calc_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+      simulation.get_calc_time());
+  std::cout << gui.clock.getElapsedTime().asMilliseconds() << '\n';
+  std::cout << calc_time.count() << '\n';
+  std::cout << simulation.get_updates() << '\n';
+  return 0;
+}
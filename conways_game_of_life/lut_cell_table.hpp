@@ -0,0 +1,243 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "rule.hpp"
+
+// Toroidal table of 2x2 cell blocks, one per byte: bit 0 is the top left
+// cell, bit 1 top right, bit 2 bottom left, bit 3 bottom right. Four blocks
+// that form a square are a 4x4 neighbourhood whose 16 bits index a table
+// of the 2x2 block at its centre one generation later, so update() does one
+// lookup per four cells and no counting. The table is built for the rule
+// by set_rule().
+//
+// The centre block lies one cell down and right of the top left block, so
+// the grid of blocks moves by one cell every generation: back and forth,
+// as odd generations look one block up and left instead.
+//
+// An odd width or height gets one more column or row of padding, which
+// update() fills with a copy of column or row 0 beforehand, so every cell
+// but those of column and row 0 sees its true neighbours. Those are
+// computed again cell by cell afterwards, from the previous generation.
+class LutCellTable {
+ public:
+  LutCellTable(const sf::Vector2u&);
+  bool get_state(int, int) const;
+  void set_state(int, int, bool);
+  void clear();
+  void randomize();
+  void randomize(uint64_t seed);
+  void update();
+  // throws std::invalid_argument for Generations rules
+  void set_rule(const Rule&);
+  const Rule& get_rule() const { return rule; }
+
+  // calls f(i, j) for every live cell
+  template <typename F>
+  void for_each_alive(F f) const;
+  // the same for the cells in [x0, x1) x [y0, y1), visiting only those
+  template <typename F>
+  void for_each_alive_in(int x0, int y0, int x1, int y1, F f) const;
+
+  const int width;
+  const int height;
+
+ private:
+  const int blocks_x;  // of the padded size
+  const int blocks_y;
+  std::vector<uint8_t> blocks;
+  std::vector<uint8_t> next;
+  std::vector<uint8_t> table;  // 64K results
+  Rule rule;
+  int offset = 0;  // the grid of blocks starts at cell (offset, offset)
+
+  // block and bit of cell (i, j) of a grid of blocks starting at `at`;
+  // padding cells are at i == width or j == height
+  size_t locate(int i, int j, int at, int& bit) const {
+    i -= at, j -= at;
+    if (i < 0) i += 2 * blocks_x;
+    if (j < 0) j += 2 * blocks_y;
+    bit = (i & 1) | (j & 1) << 1;
+    return i / 2 + size_t(j / 2) * blocks_x;
+  }
+  static bool cell(const std::vector<uint8_t>& grid, size_t index, int bit) {
+    return grid[index] >> bit & 1;
+  }
+  void fill_random(std::mt19937_64&);
+  void fill_padding();
+  void update_seam();
+};
+
+inline LutCellTable::LutCellTable(const sf::Vector2u& size)
+    : width(size.x),
+      height(size.y),
+      blocks_x((size.x + 1) / 2),
+      blocks_y((size.y + 1) / 2),
+      blocks(blocks_x * blocks_y),
+      next(blocks.size()),
+      table(1 << 16) {
+  set_rule(rule);
+  randomize();
+}
+
+inline bool LutCellTable::get_state(int i, int j) const {
+  int bit;
+  const size_t index = locate(i, j, offset, bit);
+  return cell(blocks, index, bit);
+}
+
+inline void LutCellTable::set_state(int i, int j, bool state) {
+  int bit;
+  const size_t index = locate(i, j, offset, bit);
+  blocks[index] = (blocks[index] & ~(1 << bit)) | state << bit;
+}
+
+inline void LutCellTable::clear() {
+  std::fill(blocks.begin(), blocks.end(), uint8_t());
+}
+
+inline void LutCellTable::randomize() {
+  static std::mt19937_64 rnd;
+  fill_random(rnd);
+}
+
+inline void LutCellTable::randomize(uint64_t seed) {
+  std::mt19937_64 rnd(seed);
+  fill_random(rnd);
+}
+
+inline void LutCellTable::fill_random(std::mt19937_64& rnd) {
+  uint64_t num = 0;
+  for (int j = 0; j < height; ++j) {
+    for (int i = 0; i < width; ++i, num >>= 1) {
+      if ((i & 0x3F) == 0) num = rnd();
+      set_state(i, j, num & 1);
+    }
+  }
+}
+
+// Bit 4 * b + k of an index is bit k of block b, the blocks being top left,
+// top right, bottom left, bottom right.
+inline void LutCellTable::set_rule(const Rule& next_rule) {
+  if (next_rule.states != 2) {
+    throw std::invalid_argument("LutCellTable runs two-state rules only");
+  }
+  rule = next_rule;
+  auto cell = [](int index, int x, int y) {
+    const int block = x / 2 + y / 2 * 2, bit = (x & 1) | (y & 1) << 1;
+    return index >> (4 * block + bit) & 1;
+  };
+  for (int index = 0; index < 1 << 16; ++index) {
+    uint8_t result = 0;
+    for (int y = 1; y <= 2; ++y) {
+      for (int x = 1; x <= 2; ++x) {
+        int n = 0;
+        for (int dy = -1; dy <= 1; ++dy) {
+          for (int dx = -1; dx <= 1; ++dx) {
+            n += (dx || dy) && cell(index, x + dx, y + dy);
+          }
+        }
+        const unsigned mask = cell(index, x, y) ? rule.survive : rule.birth;
+        result |= ((mask >> n) & 1) << ((x - 1) | (y - 1) << 1);
+      }
+    }
+    table[index] = result;
+  }
+}
+
+// Even offsets take each block with the ones right, below and below right
+// of it, odd offsets with the ones left, above and above left. Either way a
+// row computes the squares starting at blocks 0 .. n - 1 of a pair of rows;
+// odd offsets just store each result one block further right.
+inline void LutCellTable::update() {
+  const bool padded = 2 * blocks_x != width || 2 * blocks_y != height;
+  if (padded) fill_padding();
+  const int n = blocks_x;
+  for (int by = 0; by < blocks_y; ++by) {
+    const int pair = offset ? (by + blocks_y - 1) % blocks_y : by;
+    const int below = pair + 1 == blocks_y ? 0 : pair + 1;
+    const uint8_t* top = &blocks[size_t(pair) * n];
+    const uint8_t* bottom = &blocks[size_t(below) * n];
+    uint8_t* out = &next[size_t(by) * n];
+    uint8_t* shifted = out + offset;
+    for (int bx = 0; bx + 1 < n; ++bx) {
+      shifted[bx] = table[top[bx] | top[bx + 1] << 4 | bottom[bx] << 8 |
+                          bottom[bx + 1] << 12];
+    }
+    out[offset ? 0 : n - 1] = table[top[n - 1] | top[0] << 4 |
+                                    bottom[n - 1] << 8 | bottom[0] << 12];
+  }
+  if (padded) update_seam();
+  blocks.swap(next);
+  offset ^= 1;
+}
+
+inline void LutCellTable::fill_padding() {
+  if (2 * blocks_x != width) {
+    for (int j = 0; j < height; ++j) set_state(width, j, get_state(0, j));
+  }
+  if (2 * blocks_y != height) {
+    for (int i = 0; i < 2 * blocks_x; ++i) {
+      set_state(i, height, get_state(i == width ? 0 : i, 0));
+    }
+  }
+}
+
+// Recomputes column 0 and row 0 of the padded sides into next, reading the
+// current generation with the true wrap around.
+inline void LutCellTable::update_seam() {
+  auto step = [this](int i, int j) {
+    int n = 0;
+    for (int dy = -1; dy <= 1; ++dy) {
+      for (int dx = -1; dx <= 1; ++dx) {
+        if (dx || dy) {
+          n += get_state((i + dx + width) % width, (j + dy + height) % height);
+        }
+      }
+    }
+    const unsigned mask = get_state(i, j) ? rule.survive : rule.birth;
+    int bit;
+    const size_t index = locate(i, j, offset ^ 1, bit);
+    next[index] = (next[index] & ~(1 << bit)) | ((mask >> n) & 1) << bit;
+  };
+  if (2 * blocks_x != width) {
+    for (int j = 0; j < height; ++j) step(0, j);
+  }
+  if (2 * blocks_y != height) {
+    for (int i = 0; i < width; ++i) step(i, 0);
+  }
+}
+
+template <typename F>
+void LutCellTable::for_each_alive(F f) const {
+  for (int by = 0; by < blocks_y; ++by) {
+    for (int bx = 0; bx < blocks_x; ++bx) {
+      const uint8_t block = blocks[bx + size_t(by) * blocks_x];
+      if (!block) continue;
+      for (int bit = 0; bit < 4; ++bit) {
+        if (!(block >> bit & 1)) continue;
+        int i = 2 * bx + (bit & 1) + offset, j = 2 * by + (bit >> 1) + offset;
+        if (i == 2 * blocks_x) i = 0;
+        if (j == 2 * blocks_y) j = 0;
+        if (i < width && j < height) f(i, j);
+      }
+    }
+  }
+}
+
+template <typename F>
+void LutCellTable::for_each_alive_in(int x0, int y0, int x1, int y1,
+                                     F f) const {
+  x0 = std::max(x0, 0), x1 = std::min(x1, width);
+  y0 = std::max(y0, 0), y1 = std::min(y1, height);
+  for (int j = y0; j < y1; ++j) {
+    for (int i = x0; i < x1; ++i) {
+      if (get_state(i, j)) f(i, j);
+    }
+  }
+}
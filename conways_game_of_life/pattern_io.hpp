@@ -0,0 +1,269 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+// A pattern file in RLE (x = .., y = .., rule = .. header) or plaintext
+// (.cells) format. The file is memory-mapped and parsed straight from the
+// mapping into the table by load(), one set_state() per live cell, so even
+// multi-megabyte patterns need no intermediate buffers. Cells that fall
+// outside [0, width) x [0, height) of the table are dropped.
+class PatternFile {
+ public:
+  explicit PatternFile(const std::string& path);
+  ~PatternFile();
+  PatternFile(const PatternFile&) = delete;
+  PatternFile& operator=(const PatternFile&) = delete;
+
+  int width() const { return size_x; }
+  int height() const { return size_y; }
+  const std::string& rule() const { return rule_string; }
+
+  // sets the live cells of the pattern with its top left corner at (x, y)
+  template <typename Table>
+  void load(Table&, int x, int y) const;
+
+ private:
+  const char* data = nullptr;
+  size_t length = 0;
+  const char* body = nullptr;  // first character after the header
+  bool is_rle = false;
+  int size_x = 0;
+  int size_y = 0;
+  std::string rule_string = "B3/S23";
+
+  void read_rle_header(const std::string& path);
+  void measure_plaintext();
+  template <typename Table>
+  void load_rle(Table&, int, int) const;
+  template <typename Table>
+  void load_plaintext(Table&, int, int) const;
+};
+
+inline PatternFile::PatternFile(const std::string& path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) throw std::runtime_error("cannot open " + path);
+  struct stat info;
+  if (fstat(fd, &info) == 0 && info.st_size > 0) {
+    length = info.st_size;
+    void* map = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map != MAP_FAILED) data = static_cast<const char*>(map);
+  }
+  close(fd);
+  if (!data) throw std::runtime_error("cannot map " + path);
+  madvise(const_cast<char*>(data), length, MADV_SEQUENTIAL);
+  const size_t dot = path.rfind('.');
+  is_rle = dot == std::string::npos || path.compare(dot, 6, ".cells") != 0;
+  if (is_rle) {
+    read_rle_header(path);
+  } else {
+    measure_plaintext();
+  }
+}
+
+inline PatternFile::~PatternFile() {
+  munmap(const_cast<char*>(data), length);
+}
+
+// skips # comment lines, then parses "x = 3, y = 3, rule = B3/S23"
+inline void PatternFile::read_rle_header(const std::string& path) {
+  const char* p = data;
+  const char* end = data + length;
+  while (p < end && (*p == '#' || *p == '\n' || *p == '\r')) {
+    p = std::find(p, end, '\n');
+    if (p < end) ++p;
+  }
+  const char* line_end = std::find(p, end, '\n');
+  if (p == end || *p != 'x') {
+    throw std::runtime_error("no RLE header in " + path);
+  }
+  while (p < line_end) {
+    while (p < line_end && (*p == ' ' || *p == ',')) ++p;
+    const char* key = p;
+    while (p < line_end && *p != ' ' && *p != '=') ++p;
+    const std::string name(key, p);
+    while (p < line_end && (*p == ' ' || *p == '=')) ++p;
+    const char* value = p;
+    while (p < line_end && *p != ',' && *p != '\r') ++p;
+    std::string text(value, p);
+    text.erase(text.find_last_not_of(' ') + 1);
+    if (name == "x") size_x = std::stoi(text);
+    if (name == "y") size_y = std::stoi(text);
+    if (name == "rule") rule_string = text;
+    if (p < line_end && *p == '\r') ++p;
+  }
+  body = line_end < end ? line_end + 1 : end;
+}
+
+inline void PatternFile::measure_plaintext() {
+  const char* p = data;
+  const char* end = data + length;
+  while (p < end && *p == '!') {
+    p = std::find(p, end, '\n');
+    if (p < end) ++p;
+  }
+  body = p;
+  while (p < end) {
+    const char* line_end = std::find(p, end, '\n');
+    int columns = line_end - p;
+    if (columns && p[columns - 1] == '\r') --columns;
+    size_x = std::max(size_x, columns);
+    ++size_y;
+    p = line_end < end ? line_end + 1 : end;
+  }
+}
+
+template <typename Table>
+void PatternFile::load(Table& table, int x, int y) const {
+  if (is_rle) {
+    load_rle(table, x, y);
+  } else {
+    load_plaintext(table, x, y);
+  }
+}
+
+// <count><tag> runs: b is dead, any other letter alive, $ ends count rows,
+// ! ends the pattern; whitespace may appear anywhere
+template <typename Table>
+void PatternFile::load_rle(Table& table, int x, int y) const {
+  const char* end = data + length;
+  int i = x, j = y;
+  for (const char* p = body; p < end; ++p) {
+    int count = 0;
+    while (p < end && *p >= '0' && *p <= '9') count = count * 10 + *p++ - '0';
+    if (p == end) break;
+    count = std::max(count, 1);
+    const char c = *p;
+    if (c == '!') break;
+    if (c == '$') {
+      i = x;
+      j += count;
+    } else if (c == 'b' || c == '.') {
+      i += count;
+    } else if (c == '#') {
+      p = std::find(p, end, '\n');
+    } else if (c == ' ' || c == '\n' || c == '\r' || c == '\t') {
+      continue;
+    } else if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
+      if (j >= 0 && j < table.height) {
+        const int begin = std::max(i, 0);
+        const int stop = std::min(i + count, table.width);
+        for (int k = begin; k < stop; ++k) table.set_state(k, j, true);
+      }
+      i += count;
+    } else {
+      throw std::runtime_error(std::string("unexpected '") + c + "' in RLE");
+    }
+  }
+}
+
+// one line per row, . dead and O (or *) alive
+template <typename Table>
+void PatternFile::load_plaintext(Table& table, int x, int y) const {
+  const char* end = data + length;
+  int j = y;
+  for (const char* p = body; p < end; ++j) {
+    const char* line_end = std::find(p, end, '\n');
+    if (*p != '!' && j >= 0 && j < table.height) {
+      for (int i = x; p < line_end; ++p, ++i) {
+        if ((*p == 'O' || *p == '*') && i >= 0 && i < table.width) {
+          table.set_state(i, j, true);
+        }
+      }
+    }
+    p = line_end < end ? line_end + 1 : end;
+  }
+}
+
+// clears the table, loads the pattern file at its centre and returns the
+// rule the file asks for
+template <typename Table>
+std::string load_pattern(Table& table, const std::string& path) {
+  PatternFile pattern(path);
+  table.clear();
+  pattern.load(table, (table.width - pattern.width()) / 2,
+               (table.height - pattern.height()) / 2);
+  return pattern.rule();
+}
+
+// rule written into saved RLE files: the table's if it has get_rule()
+template <typename Table>
+std::string rule_of(const Table&, long) {
+  return "B3/S23";
+}
+
+template <typename Table>
+auto rule_of(const Table& table, int)
+    -> decltype(table.get_rule().to_string()) {
+  return table.get_rule().to_string();
+}
+
+// Writes the bounding box of the live cells as RLE, or as plaintext if the
+// path ends in .cells.
+template <typename Table>
+void save_pattern(const Table& table, const std::string& path) {
+  int x0 = table.width, y0 = table.height, x1 = -1, y1 = -1;
+  table.for_each_alive([&](int i, int j) {
+    x0 = std::min(x0, i), y0 = std::min(y0, j);
+    x1 = std::max(x1, i), y1 = std::max(y1, j);
+  });
+  if (x1 < 0) x0 = y0 = 0;
+  std::ofstream out(path, std::ios::binary);
+  if (!out) throw std::runtime_error("cannot write " + path);
+  const size_t dot = path.rfind('.');
+  if (dot != std::string::npos && path.compare(dot, 6, ".cells") == 0) {
+    out << "!Name: " << path << '\n';
+    std::string line;
+    for (int j = y0; j <= y1; ++j) {
+      line.assign(x1 - x0 + 1, '.');
+      for (int i = x0; i <= x1; ++i) {
+        if (table.get_state(i, j)) line[i - x0] = 'O';
+      }
+      line.erase(line.find_last_not_of('.') + 1);
+      out << line << '\n';
+    }
+    return;
+  }
+  out << "x = " << x1 - x0 + 1 << ", y = " << y1 - y0 + 1
+      << ", rule = " << rule_of(table, 0) << '\n';
+  // dead runs and row ends are held back until a live cell follows, so
+  // trailing dead cells and empty rows are never written
+  size_t column = 0;
+  int dead = 0, rows = 0;
+  auto emit = [&](int count, char tag) {
+    std::string run = count > 1 ? std::to_string(count) : std::string();
+    run += tag;
+    if (column + run.size() > 70) {
+      out << '\n';
+      column = 0;
+    }
+    out << run;
+    column += run.size();
+  };
+  for (int j = y0; j <= y1; ++j, ++rows) {
+    for (int i = x0; i <= x1;) {
+      const bool state = table.get_state(i, j);
+      int k = i + 1;
+      while (k <= x1 && table.get_state(k, j) == state) ++k;
+      if (state) {
+        if (rows) emit(rows, '$'), rows = 0;
+        if (dead) emit(dead, 'b'), dead = 0;
+        emit(k - i, 'o');
+      } else {
+        dead += k - i;
+      }
+      i = k;
+    }
+    dead = 0;
+  }
+  emit(1, '!');
+  out << '\n';
+}
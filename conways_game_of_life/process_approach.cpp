@@ -0,0 +1,45 @@
+#include <SFML/Graphics.hpp>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "game_of_life.hpp"
+#include "process_table.hpp"
+
+// Extra command line option: --processes N worker processes (default one
+// per hardware thread).
+int main(int argc, char** argv) {
+  const char* processes = take_option(argc, argv, "--processes");
+  const unsigned int fps_max = 0;
+  // Worker setup, the pattern and a worker dying mid-run, which acquire()
+  // rethrows from the simulation thread, all end up here.
+  try {
+    // forks the workers, so it comes before the window, its GL context and
+    // the simulation thread
+    ProcessTable table(world_size(argc, argv),
+                       processes ? std::stoi(processes)
+                                 : std::thread::hardware_concurrency());
+    if (const char* path = pattern_path(argc, argv)) load_pattern(table, path);
+    GUI gui(fps_max);
+    gui.show_world(sf::Vector2u(table.width, table.height));
+    PixelSimulation<ProcessTable> simulation(
+        table, capture_view<ProcessTable>(gui));
+    Events<ProcessTable> events(gui, simulation);
+
+    int frame_counter = 0;
+    while (gui.window.isOpen() && ++frame_counter <= 40) {
+      gui.display(simulation.acquire());
+      events.handle();
+    }
+    auto calc_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+        simulation.get_calc_time());
+    std::cout << gui.clock.getElapsedTime().asMilliseconds() << '\n';
+    std::cout << calc_time.count() << '\n';
+    std::cout << simulation.get_updates() << '\n';
+  } catch (const std::exception& error) {
+    std::cerr << error.what() << '\n';
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,547 @@
+#pragma once
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "byte_cell_table.hpp"
+#include "viewport.hpp"
+
+// Toroidal table split into a grid of rectangles, each stepped by a worker
+// process of its own. Everything the processes share lives in one POSIX
+// shared memory segment: a control block with a process-shared command
+// handshake and barrier, the cells of every rectangle, one byte per cell,
+// and a mailbox per rectangle for its border. A generation goes:
+//
+//  1. every worker copies the border of its rectangle into its mailbox,
+//  2. all workers meet at a barrier,
+//  3. every worker builds a one-cell halo around a private copy of its
+//     rectangle from the mailboxes of its eight neighbours and steps it.
+//
+// Only borders cross between workers, so the same loop would run with the
+// mailboxes replaced by messages between hosts. The owning process, the
+// coordinator, edits cells only between generations, and sample() has the
+// workers bin their own cells into a shared pixel buffer in parallel.
+//
+// The workers are forked by the constructor, so construct the table before
+// starting threads or opening a window. They are killed if the coordinator
+// dies. While it waits for a command to finish, the coordinator checks
+// every kPollMs whether a worker has exited; if one has, update() and
+// sample() throw std::runtime_error from then on, and the destructor kills
+// the rest.
+class ProcessTable {
+ public:
+  // Splits the table into `processes` rectangles, as square as the factors
+  // of `processes` allow. sample() gathers up to max_view_pixels per pass.
+  // Throws std::runtime_error if the segment or a worker cannot be made.
+  ProcessTable(const sf::Vector2u& size, int processes,
+               int max_view_pixels = 3840 * 2160);
+  ~ProcessTable();
+  ProcessTable(const ProcessTable&) = delete;
+  ProcessTable& operator=(const ProcessTable&) = delete;
+
+  bool get_state(int, int) const;
+  void set_state(int, int, bool);
+  void clear();
+  void randomize();
+  void randomize(uint64_t seed);
+  void update();
+  // fills columns x rows pixels with density_color() of the viewport
+  void sample(const Viewport&, int columns, int rows, uint32_t* pixels);
+  int get_processes() const { return blocks.size(); }
+
+  // calls f(i, j) for every live cell, rectangle by rectangle
+  template <typename F>
+  void for_each_alive(F f) const;
+
+  const int width;
+  const int height;
+
+ private:
+  enum Command { kStep, kSample, kQuit };
+  static constexpr int kPollMs = 100;
+
+  struct Control {
+    pthread_mutex_t mutex;    // robust, guards the three members below
+    uint64_t serial;          // commands issued
+    int pending;              // workers still running the command
+    Command command;
+    pthread_cond_t wake;      // workers wait for the next serial
+    pthread_cond_t finished;  // the coordinator waits for pending == 0
+    pthread_barrier_t exchange;  // workers, between steps 2 and 3
+    Viewport view;  // of the current sample pass
+    int columns;
+    int rows;
+  };
+
+  // A rectangle and where its data sit in the segment. Its mailbox holds
+  // the top row, the bottom row, the left column, the right column and the
+  // top left, top right, bottom left, bottom right corners.
+  struct Block {
+    int bx, by;  // position in the grid of rectangles
+    int x, y, w, h;
+    size_t cells;
+    size_t mailbox;
+  };
+
+  int blocks_x;
+  int blocks_y;
+  std::vector<int> column_x;  // blocks_x + 1 rectangle boundaries
+  std::vector<int> row_y;     // blocks_y + 1
+  std::vector<Block> blocks;
+  size_t max_pixels;
+  size_t length = 0;
+  uint8_t* segment = nullptr;
+  Control* control = nullptr;
+  std::atomic<uint32_t>* counts = nullptr;  // max_pixels live cell counts
+  std::vector<pid_t> workers;
+  bool failed = false;  // a worker died
+  const ByteCellTable::RowKernel kernel = ByteCellTable::select_kernel();
+
+  uint8_t* cells_of(const Block& block) const {
+    return segment + block.cells;
+  }
+  const Block& block_of(int bx, int by) const {
+    bx = (bx + blocks_x) % blocks_x;
+    by = (by + blocks_y) % blocks_y;
+    return blocks[bx + by * blocks_x];
+  }
+  // the rectangle holding cell (i, j)
+  const Block& block_at(int i, int j) const;
+  void fill_random(std::mt19937_64&);
+  static void lock(pthread_mutex_t*);
+  // waits on cond, until deadline (CLOCK_MONOTONIC) unless it is nullptr
+  static void wait(pthread_cond_t*, pthread_mutex_t*, const timespec*);
+  void run(Command);
+  bool worker_exited();
+  void stop_workers();
+  [[noreturn]] void work(const Block&);
+  void step(const Block&, std::vector<uint8_t>& padded,
+            std::vector<uint8_t>& next);
+  void sample_block(const Block&);
+};
+
+inline ProcessTable::ProcessTable(const sf::Vector2u& size, int processes,
+                                  int max_view_pixels)
+    : width(size.x), height(size.y), max_pixels(max_view_pixels) {
+  // the largest factor not above the square root goes along the shorter side
+  processes = std::max(processes, 1);
+  int factor = 1;
+  for (int f = 1; f * f <= processes; ++f) {
+    if (processes % f == 0) factor = f;
+  }
+  blocks_x = processes / factor, blocks_y = factor;
+  if (width < height) std::swap(blocks_x, blocks_y);
+  blocks_x = std::min(blocks_x, width);
+  blocks_y = std::min(blocks_y, height);
+  for (int b = 0; b <= blocks_x; ++b) {
+    column_x.push_back(int64_t(width) * b / blocks_x);
+  }
+  for (int b = 0; b <= blocks_y; ++b) {
+    row_y.push_back(int64_t(height) * b / blocks_y);
+  }
+
+  length = sizeof(Control) + max_pixels * sizeof(std::atomic<uint32_t>);
+  for (int by = 0; by < blocks_y; ++by) {
+    for (int bx = 0; bx < blocks_x; ++bx) {
+      Block block;
+      block.bx = bx, block.by = by;
+      block.x = column_x[bx], block.w = column_x[bx + 1] - block.x;
+      block.y = row_y[by], block.h = row_y[by + 1] - block.y;
+      block.cells = length;
+      length += size_t(block.w) * block.h;
+      block.mailbox = length;
+      length += 2 * block.w + 2 * block.h + 4;
+      length = (length + 63) & ~size_t(63);  // no shared cache lines
+      blocks.push_back(block);
+    }
+  }
+
+  // the name is unlinked as soon as it is mapped; the workers inherit the
+  // mapping through fork()
+  const std::string name = "/gol-" + std::to_string(getpid()) + "-" +
+                           std::to_string(uintptr_t(this));
+  int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0) throw std::runtime_error("cannot create " + name);
+  void* map = MAP_FAILED;
+  if (ftruncate(fd, length) == 0) {
+    map = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  shm_unlink(name.c_str());
+  if (map == MAP_FAILED) throw std::runtime_error("cannot map " + name);
+  segment = static_cast<uint8_t*>(map);
+
+  control = new (segment) Control();
+  counts = reinterpret_cast<std::atomic<uint32_t>*>(segment + sizeof(Control));
+  for (size_t p = 0; p < max_pixels; ++p) {
+    new (&counts[p]) std::atomic<uint32_t>(0);
+  }
+  pthread_mutexattr_t mutex_attr;
+  pthread_mutexattr_init(&mutex_attr);
+  pthread_mutexattr_setpshared(&mutex_attr, PTHREAD_PROCESS_SHARED);
+  pthread_mutexattr_setrobust(&mutex_attr, PTHREAD_MUTEX_ROBUST);
+  pthread_mutex_init(&control->mutex, &mutex_attr);
+  pthread_mutexattr_destroy(&mutex_attr);
+  pthread_condattr_t cond_attr;
+  pthread_condattr_init(&cond_attr);
+  pthread_condattr_setpshared(&cond_attr, PTHREAD_PROCESS_SHARED);
+  pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&control->wake, &cond_attr);
+  pthread_cond_init(&control->finished, &cond_attr);
+  pthread_condattr_destroy(&cond_attr);
+  pthread_barrierattr_t barrier_attr;
+  pthread_barrierattr_init(&barrier_attr);
+  pthread_barrierattr_setpshared(&barrier_attr, PTHREAD_PROCESS_SHARED);
+  pthread_barrier_init(&control->exchange, &barrier_attr, blocks.size());
+  pthread_barrierattr_destroy(&barrier_attr);
+
+  const pid_t parent = getpid();
+  for (const Block& block : blocks) {
+    const pid_t pid = fork();
+    if (pid == 0) {
+      prctl(PR_SET_PDEATHSIG, SIGKILL);
+      if (getppid() != parent) _exit(1);
+      work(block);
+    }
+    if (pid < 0) {
+      stop_workers();
+      throw std::runtime_error("cannot fork a worker");
+    }
+    workers.push_back(pid);
+  }
+}
+
+inline ProcessTable::~ProcessTable() {
+  if (failed) {
+    stop_workers();
+    return;
+  }
+  lock(&control->mutex);
+  control->command = kQuit;
+  ++control->serial;
+  pthread_cond_broadcast(&control->wake);
+  pthread_mutex_unlock(&control->mutex);
+  for (pid_t pid : workers) waitpid(pid, nullptr, 0);
+  pthread_mutex_destroy(&control->mutex);
+  pthread_cond_destroy(&control->wake);
+  pthread_cond_destroy(&control->finished);
+  pthread_barrier_destroy(&control->exchange);
+  munmap(segment, length);
+}
+
+// A worker that dies while holding the mutex leaves it to the next owner,
+// who marks it usable again; the death itself shows in worker_exited().
+inline void ProcessTable::lock(pthread_mutex_t* mutex) {
+  if (pthread_mutex_lock(mutex) == EOWNERDEAD) {
+    pthread_mutex_consistent(mutex);
+  }
+}
+
+inline void ProcessTable::wait(pthread_cond_t* cond, pthread_mutex_t* mutex,
+                               const timespec* deadline) {
+  const int error = deadline ? pthread_cond_timedwait(cond, mutex, deadline)
+                             : pthread_cond_wait(cond, mutex);
+  if (error == EOWNERDEAD) pthread_mutex_consistent(mutex);
+}
+
+// Reaps the workers that have exited, true if there were any. Their pids
+// are dropped at once, as they may be reused by unrelated processes that
+// stop_workers() must not kill.
+inline bool ProcessTable::worker_exited() {
+  const size_t running = workers.size();
+  workers.erase(std::remove_if(workers.begin(), workers.end(),
+                               [](pid_t pid) {
+                                 return waitpid(pid, nullptr, WNOHANG) == pid;
+                               }),
+                workers.end());
+  return workers.size() != running;
+}
+
+// workers that are already waiting at a barrier cannot be told to quit
+inline void ProcessTable::stop_workers() {
+  for (pid_t pid : workers) kill(pid, SIGKILL);
+  for (pid_t pid : workers) waitpid(pid, nullptr, 0);
+  munmap(segment, length);
+}
+
+inline const ProcessTable::Block& ProcessTable::block_at(int i, int j) const {
+  const int bx = std::upper_bound(column_x.begin(), column_x.end(), i) -
+                 column_x.begin() - 1;
+  const int by =
+      std::upper_bound(row_y.begin(), row_y.end(), j) - row_y.begin() - 1;
+  return blocks[bx + by * blocks_x];
+}
+
+inline bool ProcessTable::get_state(int i, int j) const {
+  const Block& block = block_at(i, j);
+  return cells_of(block)[(i - block.x) + (j - block.y) * block.w];
+}
+
+inline void ProcessTable::set_state(int i, int j, bool state) {
+  const Block& block = block_at(i, j);
+  cells_of(block)[(i - block.x) + (j - block.y) * block.w] = state;
+}
+
+inline void ProcessTable::clear() {
+  for (const Block& block : blocks) {
+    std::memset(cells_of(block), 0, size_t(block.w) * block.h);
+  }
+}
+
+inline void ProcessTable::randomize() {
+  static std::mt19937_64 rnd;
+  fill_random(rnd);
+}
+
+inline void ProcessTable::randomize(uint64_t seed) {
+  std::mt19937_64 rnd(seed);
+  fill_random(rnd);
+}
+
+// the same sequence of cells as the other tables, row by row over the whole
+// table, so equal seeds give equal boards
+inline void ProcessTable::fill_random(std::mt19937_64& rnd) {
+  uint64_t num = 0;
+  for (int j = 0; j < height; ++j) {
+    for (int i = 0; i < width; ++i, num >>= 1) {
+      if ((i & 0x3F) == 0) num = rnd();
+      set_state(i, j, num & 1);
+    }
+  }
+}
+
+inline void ProcessTable::update() {
+  run(kStep);
+}
+
+// A dead worker would leave the others, and the coordinator, waiting
+// forever, so the coordinator wakes every kPollMs to look for one.
+inline void ProcessTable::run(Command command) {
+  if (failed) throw std::runtime_error("a worker process died");
+  lock(&control->mutex);
+  control->command = command;
+  ++control->serial;
+  control->pending = blocks.size();
+  pthread_cond_broadcast(&control->wake);
+  while (control->pending != 0) {
+    timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_nsec += kPollMs * 1000000L;
+    deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+    deadline.tv_nsec %= 1000000000L;
+    wait(&control->finished, &control->mutex, &deadline);
+    if (control->pending != 0 && worker_exited()) {
+      failed = true;
+      pthread_mutex_unlock(&control->mutex);
+      throw std::runtime_error("a worker process died");
+    }
+  }
+  pthread_mutex_unlock(&control->mutex);
+}
+
+inline void ProcessTable::work(const Block& block) {
+  std::vector<uint8_t> padded(size_t(block.w + 2) * (block.h + 2));
+  std::vector<uint8_t> next(block.w + 2);
+  uint64_t seen = 0;
+  while (true) {
+    lock(&control->mutex);
+    while (control->serial == seen) {
+      wait(&control->wake, &control->mutex, nullptr);
+    }
+    seen = control->serial;
+    const Command command = control->command;
+    pthread_mutex_unlock(&control->mutex);
+    switch (command) {
+      case kStep:
+        step(block, padded, next);
+        break;
+      case kSample:
+        sample_block(block);
+        break;
+      case kQuit:
+        _exit(0);
+    }
+    lock(&control->mutex);
+    if (--control->pending == 0) pthread_cond_signal(&control->finished);
+    pthread_mutex_unlock(&control->mutex);
+  }
+}
+
+inline void ProcessTable::step(const Block& block,
+                               std::vector<uint8_t>& padded,
+                               std::vector<uint8_t>& next) {
+  const int w = block.w, h = block.h, stride = w + 2;
+  uint8_t* cells = cells_of(block);
+  uint8_t* box = segment + block.mailbox;
+  std::memcpy(box, cells, w);
+  std::memcpy(box + w, cells + size_t(h - 1) * w, w);
+  for (int r = 0; r < h; ++r) {
+    box[2 * w + r] = cells[size_t(r) * w];
+    box[2 * w + h + r] = cells[size_t(r) * w + w - 1];
+  }
+  uint8_t* corner = box + 2 * w + 2 * h;
+  corner[0] = cells[0];
+  corner[1] = cells[w - 1];
+  corner[2] = cells[size_t(h - 1) * w];
+  corner[3] = cells[size_t(h) * w - 1];
+
+  pthread_barrier_wait(&control->exchange);
+
+  // offsets into a neighbour's mailbox follow its own size; the ones to the
+  // left and right have the same h, the ones above and below the same w
+  auto neighbour = [this, &block](int dx, int dy) -> const Block& {
+    return block_of(block.bx + dx, block.by + dy);
+  };
+  auto mailbox = [this](const Block& other) -> const uint8_t* {
+    return segment + other.mailbox;
+  };
+  auto corners = [&mailbox](const Block& other) {
+    return mailbox(other) + 2 * other.w + 2 * other.h;
+  };
+  const Block& up = neighbour(0, -1);
+  const Block& down = neighbour(0, 1);
+  const Block& left = neighbour(-1, 0);
+  const Block& right = neighbour(1, 0);
+  uint8_t* p = padded.data();
+  const size_t bottom = size_t(h + 1) * stride;
+  std::memcpy(p + 1, mailbox(up) + w, w);         // their bottom row
+  std::memcpy(p + bottom + 1, mailbox(down), w);  // their top row
+  const uint8_t* left_column = mailbox(left) + 2 * left.w + h;
+  const uint8_t* right_column = mailbox(right) + 2 * right.w;
+  for (int r = 0; r < h; ++r) {
+    uint8_t* row = p + size_t(r + 1) * stride;
+    row[0] = left_column[r];
+    std::memcpy(row + 1, cells + size_t(r) * w, w);
+    row[w + 1] = right_column[r];
+  }
+  p[0] = corners(neighbour(-1, -1))[3];
+  p[w + 1] = corners(neighbour(1, -1))[2];
+  p[bottom] = corners(neighbour(-1, 1))[1];
+  p[bottom + w + 1] = corners(neighbour(1, 1))[0];
+
+  // the halo makes every cell an inner one for the row kernels
+  for (int r = 0; r < h; ++r) {
+    const uint8_t* above = p + size_t(r) * stride;
+    const uint8_t* mid = above + stride;
+    const uint8_t* below = mid + stride;
+    if (kernel) {
+      kernel(above, mid, below, next.data(), 1, w + 1);
+    } else {
+      for (int c = 1; c <= w; ++c) {
+        next[c] = ByteCellTable::next_state(above, mid, below, c - 1, c, c + 1);
+      }
+    }
+    std::memcpy(cells + size_t(r) * w, next.data() + 1, w);
+  }
+}
+
+inline void ProcessTable::sample(const Viewport& view, int columns, int rows,
+                                 uint32_t* pixels) {
+  // passes of whole rows, a multiple of 32 so that zoomed in they start on
+  // a cell boundary
+  const int pass_rows = std::max<int>(max_pixels / columns / 32 * 32, 32);
+  for (int py0 = 0; py0 < rows; py0 += pass_rows) {
+    control->view = view;
+    control->view.y = view.cell_y(py0);
+    control->columns = columns;
+    control->rows = std::min(pass_rows, rows - py0);
+    const size_t count = size_t(columns) * control->rows;
+    if (count > max_pixels) return;  // a row wider than the buffer
+    if (view.zoom > 0) {
+      for (size_t p = 0; p < count; ++p) {
+        counts[p].store(0, std::memory_order_relaxed);
+      }
+    }
+    run(kSample);
+    const Viewport& v = control->view;
+    for (int py = 0; py < control->rows; ++py) {
+      const int j0 = std::max(v.cell_y(py), 0);
+      const int j1 = std::min(v.cell_y(py + 1), height);
+      for (int px = 0; px < columns; ++px) {
+        const uint32_t alive =
+            counts[px + size_t(py) * columns].load(std::memory_order_relaxed);
+        uint32_t& pixel = pixels[px + size_t(py0 + py) * columns];
+        if (v.zoom <= 0) {
+          const int i = v.cell_x(px), j = v.cell_y(py);
+          const bool inside = i >= 0 && i < width && j >= 0 && j < height;
+          pixel = density_color(inside ? alive : 0, inside);
+          continue;
+        }
+        const int i0 = std::max(v.cell_x(px), 0);
+        const int i1 = std::min(v.cell_x(px + 1), width);
+        const int cells = std::max(i1 - i0, 0) * std::max(j1 - j0, 0);
+        pixel = density_color(alive, cells);
+      }
+    }
+  }
+}
+
+// Zoomed in, each pixel shows one cell and has one writer; zoomed out, the
+// rectangle's cells are summed per pixel row segment before one atomic add,
+// as pixels on a rectangle's border also get cells of its neighbours.
+inline void ProcessTable::sample_block(const Block& block) {
+  const Viewport view = control->view;
+  const int columns = control->columns, rows = control->rows;
+  const uint8_t* cells = cells_of(block);
+  if (view.zoom <= 0) {
+    const int scale = 1 << -view.zoom;
+    const int px0 = std::max((block.x - view.x) * scale, 0);
+    const int px1 = std::min((block.x + block.w - view.x) * scale, columns);
+    const int py0 = std::max((block.y - view.y) * scale, 0);
+    const int py1 = std::min((block.y + block.h - view.y) * scale, rows);
+    for (int py = py0; py < py1; ++py) {
+      const uint8_t* row = cells + size_t(view.cell_y(py) - block.y) * block.w;
+      for (int px = px0; px < px1; ++px) {
+        counts[px + size_t(py) * columns].store(
+            row[view.cell_x(px) - block.x], std::memory_order_relaxed);
+      }
+    }
+    return;
+  }
+  const int i0 = std::max(block.x, view.x);
+  const int i1 = std::min(block.x + block.w, view.cell_x(columns));
+  const int j0 = std::max(block.y, view.y);
+  const int j1 = std::min(block.y + block.h, view.cell_y(rows));
+  for (int j = j0; j < j1; ++j) {
+    const uint8_t* row = cells + size_t(j - block.y) * block.w;
+    std::atomic<uint32_t>* out =
+        counts + size_t((j - view.y) >> view.zoom) * columns;
+    for (int i = i0; i < i1;) {
+      const int px = (i - view.x) >> view.zoom;
+      const int end = std::min(view.cell_x(px + 1), i1);
+      uint32_t alive = 0;
+      for (; i < end; ++i) alive += row[i - block.x];
+      if (alive) out[px].fetch_add(alive, std::memory_order_relaxed);
+    }
+  }
+}
+
+template <typename F>
+void ProcessTable::for_each_alive(F f) const {
+  for (const Block& block : blocks) {
+    const uint8_t* cells = cells_of(block);
+    for (int r = 0; r < block.h; ++r) {
+      for (int c = 0; c < block.w; ++c) {
+        if (cells[c + size_t(r) * block.w]) f(block.x + c, block.y + r);
+      }
+    }
+  }
+}
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Streams RGBA frames of a fixed size to disk on a thread of its own. The
+// caller's only cost is one copy into a preallocated buffer of the pool;
+// encoding and file I/O happen on the writer thread, which writes raw
+// frames straight from that buffer and loads it into an sf::Image of its
+// own for PNGs. When every buffer is waiting for the writer, push() either
+// drops the frame or blocks until one is free.
+//
+// A path ending in .png gives one file per frame, <stem>_<index>.png with
+// eight digits of index. Any other path is a raw framestream: the magic
+// "GOLF", uint32 width, height and bytes per pixel (4), then per frame a
+// uint64 index followed by width * height RGBA pixels, all in native byte
+// order (little endian on x86).
+class Recorder {
+ public:
+  enum class Overflow { kDrop, kBlock };
+
+  // throws std::runtime_error if the framestream cannot be created
+  Recorder(const std::string& path, sf::Vector2u size, Overflow overflow,
+           int buffers = 8);
+  // writes the frames still queued, then stops the writer
+  ~Recorder();
+  Recorder(const Recorder&) = delete;
+  Recorder& operator=(const Recorder&) = delete;
+
+  // Queues a copy of size.x * size.y pixels under the given index, e.g. the
+  // generation. False if it was dropped.
+  bool push(const uint32_t* pixels, uint64_t index);
+
+  uint64_t get_written() const;
+  uint64_t get_dropped() const;
+
+ private:
+  struct Buffer {
+    std::vector<uint32_t> pixels;
+    uint64_t index = 0;
+  };
+
+  const sf::Vector2u size;
+  const Overflow overflow;
+  const bool png;
+  std::string stem;  // path without .png
+  std::ofstream stream;
+  std::vector<Buffer> pool;
+  std::vector<Buffer*> free_buffers;
+  std::deque<Buffer*> queue;
+  mutable std::mutex mutex;
+  std::condition_variable freed;
+  std::condition_variable queued;
+  bool stopping = false;
+  uint64_t written = 0;
+  uint64_t dropped = 0;
+  sf::Image image;  // writer thread only, for PNGs
+  std::thread thread;
+
+  void run();
+  void write(const Buffer&);
+};
+
+inline Recorder::Recorder(const std::string& path, sf::Vector2u size,
+                          Overflow overflow, int buffers)
+    : size(size),
+      overflow(overflow),
+      png(path.size() >= 4 && path.compare(path.size() - 4, 4, ".png") == 0),
+      pool(std::max(buffers, 1)) {
+  if (png) {
+    stem = path.substr(0, path.size() - 4);
+  } else {
+    stream.open(path, std::ios::binary);
+    if (!stream) throw std::runtime_error("cannot write " + path);
+    const uint32_t header[3] = {size.x, size.y, 4};
+    stream.write("GOLF", 4);
+    stream.write(reinterpret_cast<const char*>(header), sizeof header);
+  }
+  for (Buffer& buffer : pool) {
+    buffer.pixels.resize(size_t(size.x) * size.y);
+    free_buffers.push_back(&buffer);
+  }
+  thread = std::thread(&Recorder::run, this);
+}
+
+inline Recorder::~Recorder() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  queued.notify_one();
+  thread.join();
+}
+
+inline bool Recorder::push(const uint32_t* pixels, uint64_t index) {
+  Buffer* buffer;
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (free_buffers.empty() && overflow == Overflow::kDrop) {
+      ++dropped;
+      return false;
+    }
+    freed.wait(lock, [this] { return !free_buffers.empty(); });
+    buffer = free_buffers.back();
+    free_buffers.pop_back();
+  }
+  // the buffer is neither free nor queued, so nobody else touches it
+  std::memcpy(buffer->pixels.data(), pixels,
+              buffer->pixels.size() * sizeof(uint32_t));
+  buffer->index = index;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    queue.push_back(buffer);
+  }
+  queued.notify_one();
+  return true;
+}
+
+inline uint64_t Recorder::get_written() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return written;
+}
+
+inline uint64_t Recorder::get_dropped() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return dropped;
+}
+
+inline void Recorder::run() {
+  while (true) {
+    Buffer* buffer;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      queued.wait(lock, [this] { return stopping || !queue.empty(); });
+      if (queue.empty()) break;
+      buffer = queue.front();
+      queue.pop_front();
+    }
+    write(*buffer);
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      free_buffers.push_back(buffer);
+      ++written;
+    }
+    freed.notify_one();
+  }
+  stream.flush();
+}
+
+inline void Recorder::write(const Buffer& buffer) {
+  if (png) {
+    char suffix[32];
+    std::snprintf(suffix, sizeof suffix, "_%08llu.png",
+                  static_cast<unsigned long long>(buffer.index));
+    image.create(size.x, size.y,
+                 reinterpret_cast<const sf::Uint8*>(buffer.pixels.data()));
+    if (!image.saveToFile(stem + suffix)) {
+      std::cerr << "cannot write " << stem + suffix << '\n';
+    }
+    return;
+  }
+  stream.write(reinterpret_cast<const char*>(&buffer.index),
+               sizeof buffer.index);
+  stream.write(reinterpret_cast<const char*>(buffer.pixels.data()),
+               std::streamsize(buffer.pixels.size() * sizeof(uint32_t)));
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+// Outer-totalistic rule: bit n of birth (survive) is set if a dead (live)
+// cell with n live neighbours is alive in the next generation. Generations
+// rules have states > 2; a live cell that does not survive then fades
+// through the dying states 2 .. states - 1, which neither count as
+// neighbours nor can be born into, before it is dead again.
+struct Rule {
+  uint16_t birth = 1 << 3;
+  uint16_t survive = 1 << 2 | 1 << 3;
+  int states = 2;
+
+  // "B36/S23", "23/36" (S/B), "B2/S/C3" or "/2/3" (S/B/C); throws
+  // std::invalid_argument for anything else. A Golly topology suffix such
+  // as ":T100,100" is ignored; each engine keeps its own topology, a torus
+  // for the dense tables and an unbounded plane for HashLife and Sparse.
+  static Rule parse(const std::string&);
+  std::string to_string() const;
+
+  bool operator==(const Rule& other) const {
+    return birth == other.birth && survive == other.survive &&
+           states == other.states;
+  }
+  bool operator!=(const Rule& other) const { return !(*this == other); }
+};
+
+// Two-state rules known at compile time; the engines instantiate their
+// update loop once per FixedRule so the masks become immediates.
+template <uint16_t Birth, uint16_t Survive>
+struct FixedRule {
+  static constexpr uint16_t birth = Birth;
+  static constexpr uint16_t survive = Survive;
+};
+
+// every other two-state rule, read from memory
+struct RuntimeRule {
+  uint16_t birth;
+  uint16_t survive;
+};
+
+// Calls f with the FixedRule matching a two-state rule, or with a
+// RuntimeRule if none does. Generations rules are not handled here.
+template <typename F>
+void dispatch_rule(const Rule& rule, F f) {
+  const uint16_t b = rule.birth, s = rule.survive;
+  if (b == 0x008 && s == 0x00C) {
+    f(FixedRule<0x008, 0x00C>());  // B3/S23, Conway's life
+  } else if (b == 0x048 && s == 0x00C) {
+    f(FixedRule<0x048, 0x00C>());  // B36/S23, HighLife
+  } else if (b == 0x1C8 && s == 0x1D8) {
+    f(FixedRule<0x1C8, 0x1D8>());  // B3678/S34678, Day & Night
+  } else if (b == 0x004 && s == 0x000) {
+    f(FixedRule<0x004, 0x000>());  // B2/S, Seeds
+  } else if (b == 0x008 && s == 0x1FF) {
+    f(FixedRule<0x008, 0x1FF>());  // B3/S012345678, Life without death
+  } else {
+    f(RuntimeRule{b, s});
+  }
+}
+
+inline Rule Rule::parse(const std::string& rule_string) {
+  const std::string text = rule_string.substr(0, rule_string.find(':'));
+  auto fail = [&text]() -> Rule {
+    throw std::invalid_argument("bad rule " + text);
+  };
+  // up to three '/'-separated fields, each an optional letter and digits
+  std::string fields[3];
+  char letters[3] = {};
+  int count = 0;
+  for (size_t begin = 0; begin <= text.size(); ++count) {
+    if (count == 3) return fail();
+    size_t end = std::min(text.find('/', begin), text.size());
+    std::string field = text.substr(begin, end - begin);
+    if (!field.empty() && !(field[0] >= '0' && field[0] <= '9')) {
+      letters[count] = field[0] & ~0x20;  // upper case
+      field.erase(0, 1);
+    }
+    fields[count] = field;
+    begin = end + 1;
+  }
+  if (count < 2) return fail();
+  Rule rule;
+  rule.birth = rule.survive = 0;
+  bool lettered = letters[0] || letters[1];
+  for (int f = 0; f < count; ++f) {
+    // without letters the order is S/B/C
+    char kind = lettered ? letters[f] : "SBC"[f];
+    if (kind == 'C' || kind == 'G') {
+      if (fields[f].empty()) return fail();
+      rule.states = std::stoi(fields[f]);
+      if (rule.states < 2 || rule.states > 254) return fail();
+      continue;
+    }
+    if (kind != 'B' && kind != 'S') return fail();
+    uint16_t mask = 0;
+    for (char c : fields[f]) {
+      if (c < '0' || c > '8') return fail();
+      mask |= 1 << (c - '0');
+    }
+    (kind == 'B' ? rule.birth : rule.survive) = mask;
+  }
+  return rule;
+}
+
+inline std::string Rule::to_string() const {
+  std::string text = "B";
+  for (int n = 0; n <= 8; ++n) {
+    if (birth >> n & 1) text += char('0' + n);
+  }
+  text += "/S";
+  for (int n = 0; n <= 8; ++n) {
+    if (survive >> n & 1) text += char('0' + n);
+  }
+  if (states > 2) text += "/C" + std::to_string(states);
+  return text;
+}
@@ -1,50 +1,51 @@
 #include <SFML/Graphics.hpp>
+#include <chrono>
 #include <iostream>
-#include <random>
 #include <vector>
 
-class CellTable {
- public:
-  using Bool = uint8_t;
-  CellTable(const sf::Vector2u&);
-  Bool at(int i, int j) const { return cells[i + j * width]; }
-  void toggle(int, int);
-  void clear();
-  void randomize();
-  void update();
-
-  const int width;
-  const int height;
+#include "../common/profiler.hpp"
+#include "byte_cell_table.hpp"
+#include "simulation.hpp"
 
- private:
-  std::vector<Bool> cells;
-  std::vector<uint8_t> neighbors;
-
-  void fix_neighbors(int, int);
+struct CellFrame {
+  int width = 0;
+  int height = 0;
+  std::vector<ByteCellTable::Bool> cells;
 };
 
+using CellSimulation = Simulation<ByteCellTable, CellFrame>;
+
 struct GUI {
   sf::RenderWindow window;
-  sf::RectangleShape shape;
+  // one quad per horizontal run of live cells, all drawn in a single call;
+  // clear() keeps the capacity, so the array stops reallocating once it has
+  // held the largest frame
+  sf::VertexArray spans;
   const sf::Clock clock;
   const float cell_size;
   const unsigned int fps_max;
   bool is_paused;
+  ProfileOverlay overlay;
   // window(sf::VideoMode(x, y), "Conway's Game of Life")
 
   GUI(float cell_size, unsigned int fps_max);
-  void display(const CellTable&);
+  // draws the previous frame again if frame is nullptr
+  void display(const CellFrame* frame);
+
+ private:
+  void build_spans(const CellFrame&);
 };
 
 class Events {
  public:
-  Events(GUI& gui, CellTable& table) : gui(gui), table(table) {}
+  Events(GUI& gui, CellSimulation& simulation)
+      : gui(gui), simulation(simulation) {}
   void handle();
 
  private:
   sf::Event event;
   GUI& gui;
-  CellTable& table;
+  CellSimulation& simulation;
 
   void handle_keyboard();
   void handle_mouse();
@@ -53,25 +54,25 @@ class Events {
 int main() {
   const unsigned int cell_size = 1, fps_max = 0;
   GUI gui(cell_size, fps_max);
-  CellTable table(gui.window.getSize() / cell_size);
-  Events events(gui, table);
-
-  sf::Time calc_time;
-  sf::Clock cl;
+  ByteCellTable table(gui.window.getSize() / cell_size);
+  CellSimulation simulation(
+      table, [](const ByteCellTable& table, CellFrame& frame) {
+        frame.width = table.width;
+        frame.height = table.height;
+        frame.cells = table.get_cells();
+      });
+  Events events(gui, simulation);
 
   int frame_counter = 0;
   while (gui.window.isOpen() && ++frame_counter <= 40) {
-    gui.display(table);
-
-    cl.restart();
-
+    gui.display(simulation.acquire());
     events.handle();
-    if (!gui.is_paused) table.update();
-
-    calc_time += cl.getElapsedTime();
   }
+  auto calc_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+      simulation.get_calc_time());
   std::cout << gui.clock.getElapsedTime().asMilliseconds() << '\n';
-  std::cout << calc_time.asMilliseconds() << '\n';
+  std::cout << calc_time.count() << '\n';
+  std::cout << simulation.get_updates() << '\n';
   return 0;
 }
 /*
@@ -81,98 +82,57 @@ int main() {
  *  N        (new table with random cells)
  *  P        (pause and show mouse coursor)
  *  F        (unlock fps)
+ *  O        (show section timings)
+ *  T        (write the recorded timings to trace.json)
  */
 
-CellTable::CellTable(
-    const sf::Vector2u& size) : width(size.x),
-                                height(size.y),
-                                cells(size.x * size.y),
-                                neighbors(size.x * size.y) {
-  randomize();
-}
-
-void CellTable::toggle(int i, int j) {
-  int index = i + j * width;
-  cells[index] = !cells[index];
-}
-
-void CellTable::clear() {
-  std::fill(cells.begin(), cells.end(), Bool());
-}
-
-void CellTable::randomize() {
-  static std::mt19937_64 rnd;
-  uint64_t num;
-  for (int j = 0; j < height; ++j) {
-    for (int i = 0; i < width; ++i, num >>= 1) {
-      if ((i & 0x3F) == 0) num = rnd();
-      if (at(i, j) != (num & 1)) toggle(i, j);
-    }
-  }
-}
-
-void CellTable::update() {
-  std::fill(neighbors.begin(), neighbors.end(), uint8_t());
-  for (int j = 0; j < height; ++j) {
-    for (int i = 0; i < width; ++i) {
-      if (at(i, j)) fix_neighbors(i, j);
-    }
-  }
-  for (int j = 0; j < height; ++j) {
-    for (int i = 0; i < width; ++i) {
-      int index = i + j * width;
-      if (cells[index]) {
-        if (neighbors[index] < 2 || neighbors[index] > 3) {
-          toggle(i, j);
-        }
-      } else if (neighbors[index] == 3) {
-        toggle(i, j);
-      }
-    }
-  }
-}
-
-void CellTable::fix_neighbors(int i, int j) {
-  const int offsets[8][2] = {
-      {-1, -1}, {0, -1}, {1, -1}, {-1, 0}, {1, 0}, {-1, 1}, {0, 1}, {1, 1}};
-  for (auto offset : offsets) {
-    int io = i + offset[0];
-    int jo = j + offset[1];
-    if (io < 0) io += width;
-    if (io >= width) io -= width;
-    if (jo < 0) jo += height;
-    if (jo >= height) jo -= height;
-    ++neighbors[io + jo * width];
-  }
-}
-
 GUI::GUI(float cell_size, unsigned int fps_max)
     : window(sf::VideoMode(sf::VideoMode::getDesktopMode()),
              "Conway's Game of Life", sf::Style::Fullscreen),
+      spans(sf::Quads),
       cell_size(cell_size),
       fps_max(fps_max),
       is_paused(false) {
   window.setFramerateLimit(fps_max);
   window.setMouseCursorVisible(false);
-  shape.setSize({cell_size, cell_size});
-  shape.setFillColor(sf::Color::White);
+  Profiler::get().name_thread("render");
 }
 
-void GUI::display(const CellTable& table) {
+void GUI::display(const CellFrame* frame) {
+  ProfileScope scope("GUI::display");
+  if (frame) build_spans(*frame);
   window.clear();
-  for (int j = 0; j < table.height; ++j) {
-    for (int i = 0; i < table.width; ++i) {
-      if (table.at(i, j)) {
-        shape.setPosition({static_cast<float>(i) * cell_size,
-                           static_cast<float>(j) * cell_size});
-        window.draw(shape);
+  window.draw(spans);
+  overlay.draw(window);
+  ProfileScope swap("window.display");
+  window.display();
+}
+
+void GUI::build_spans(const CellFrame& frame) {
+  ProfileScope scope("GUI::build_spans");
+  spans.clear();
+  for (int j = 0; j < frame.height; ++j) {
+    const ByteCellTable::Bool* row = &frame.cells[j * frame.width];
+    for (int i = 0; i < frame.width;) {
+      if (!row[i]) {
+        ++i;
+        continue;
       }
+      int end = i;
+      while (end < frame.width && row[end]) ++end;
+      const float left = i * cell_size, right = end * cell_size;
+      const float top = j * cell_size, bottom = top + cell_size;
+      spans.append(sf::Vertex({left, top}, sf::Color::White));
+      spans.append(sf::Vertex({right, top}, sf::Color::White));
+      spans.append(sf::Vertex({right, bottom}, sf::Color::White));
+      spans.append(sf::Vertex({left, bottom}, sf::Color::White));
+      i = end;
     }
   }
-  window.display();
 }
 
 void Events::handle() {
+  ProfileScope scope("Events::handle");
   while (gui.window.pollEvent(event)) {
     switch (event.type) {
       case sf::Event::Closed:
@@ -197,10 +157,10 @@ void Events::handle_keyboard() {
       gui.window.close();
       break;
     case sf::Keyboard::N:
-      table.randomize();
+      simulation.post([](ByteCellTable& table) { table.randomize(); });
       break;
     case sf::Keyboard::C:
-      table.clear();
+      simulation.post([](ByteCellTable& table) { table.clear(); });
       break;
     case sf::Keyboard::F:
       static bool unlocked = false;
@@ -210,6 +170,15 @@ void Events::handle_keyboard() {
     case sf::Keyboard::P:
       gui.is_paused = !gui.is_paused;
       gui.window.setMouseCursorVisible(gui.is_paused);
+      simulation.set_paused(gui.is_paused);
+      break;
+    case sf::Keyboard::O:
+      gui.overlay.toggle();
+      break;
+    case sf::Keyboard::T:
+      if (!Profiler::get().write_chrome_trace("trace.json")) {
+        std::cerr << "cannot write trace.json\n";
+      }
       break;
     default:
       break;
@@ -220,5 +189,5 @@ void Events::handle_mouse() {
   sf::Vector2i p = sf::Mouse::getPosition() - gui.window.getPosition();
   int x = p.x / static_cast<int>(gui.cell_size);
   int y = p.y / static_cast<int>(gui.cell_size);
-  table.toggle(x, y);
+  simulation.post([x, y](ByteCellTable& table) { table.toggle(x, y); });
 }
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "../common/profiler.hpp"
+
+// Runs table.update() on a thread of its own, as fast as it can, and hands
+// finished generations to the render thread through a lock-free triple
+// buffer of Frames. A frame is captured only once the renderer has taken the
+// previous one, so capturing costs at most one copy per displayed frame.
+// Everything else that touches the table (mouse toggles, clear, randomize)
+// is posted as a command and applied between two generations. An exception
+// thrown by the table, a command or the capture ends the simulation thread
+// and is rethrown by the next acquire() on the render thread.
+template <typename Table, typename Frame>
+class Simulation {
+ public:
+  using Command = std::function<void(Table&)>;
+  // may reset per-frame bookkeeping of the table, such as dirty regions
+  using Capture = std::function<void(Table&, Frame&)>;
+
+  Simulation(Table& table, Capture capture);
+  ~Simulation();
+  Simulation(const Simulation&) = delete;
+  Simulation& operator=(const Simulation&) = delete;
+
+  void post(Command command);
+  void set_paused(bool paused);
+  // the newest finished frame, or nullptr if there is none since last call;
+  // the frame stays valid until the next call. Rethrows what stopped the
+  // simulation thread, if anything did.
+  const Frame* acquire();
+
+  // number of table.update() calls so far
+  uint64_t get_updates() const { return updates; }
+  // time spent inside table.update()
+  std::chrono::nanoseconds get_calc_time() const {
+    return std::chrono::nanoseconds(calc_ns.load());
+  }
+
+ private:
+  static constexpr unsigned kFresh = 4;  // flag next to the index in middle
+
+  Table& table;
+  const Capture capture;
+  Frame frames[3];
+  unsigned back = 0;                  // written by the simulation thread
+  std::atomic<unsigned> middle{1};    // last published frame | kFresh
+  unsigned front = 2;                 // read by the render thread
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::vector<Command> commands;
+  bool paused = false;
+  bool stopping = false;
+  std::atomic<uint64_t> updates{0};
+  std::atomic<int64_t> calc_ns{0};
+  std::exception_ptr error;  // written once, before failed is set
+  std::atomic<bool> failed{false};
+  std::thread thread;
+
+  void run();
+  void loop();
+  void publish();
+};
+
+template <typename Table, typename Frame>
+Simulation<Table, Frame>::Simulation(Table& table, Capture capture)
+    : table(table), capture(std::move(capture)) {
+  publish();
+  thread = std::thread(&Simulation::run, this);
+}
+
+template <typename Table, typename Frame>
+Simulation<Table, Frame>::~Simulation() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wake.notify_one();
+  thread.join();
+}
+
+template <typename Table, typename Frame>
+void Simulation<Table, Frame>::post(Command command) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    commands.push_back(std::move(command));
+  }
+  wake.notify_one();
+}
+
+template <typename Table, typename Frame>
+void Simulation<Table, Frame>::set_paused(bool state) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    paused = state;
+  }
+  wake.notify_one();
+}
+
+template <typename Table, typename Frame>
+const Frame* Simulation<Table, Frame>::acquire() {
+  if (failed.load(std::memory_order_acquire)) std::rethrow_exception(error);
+  if (!(middle.load(std::memory_order_relaxed) & kFresh)) return nullptr;
+  front = middle.exchange(front, std::memory_order_acq_rel) & ~kFresh;
+  return &frames[front];
+}
+
+template <typename Table, typename Frame>
+void Simulation<Table, Frame>::publish() {
+  ProfileScope scope("capture");
+  capture(table, frames[back]);
+  back = middle.exchange(back | kFresh, std::memory_order_acq_rel) & ~kFresh;
+}
+
+template <typename Table, typename Frame>
+void Simulation<Table, Frame>::run() {
+  Profiler::get().name_thread("simulation");
+  try {
+    loop();
+  } catch (...) {
+    error = std::current_exception();
+    failed.store(true, std::memory_order_release);
+  }
+}
+
+template <typename Table, typename Frame>
+void Simulation<Table, Frame>::loop() {
+  std::vector<Command> pending;
+  while (true) {
+    bool running;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      wake.wait(lock, [this] {
+        return stopping || !paused || !commands.empty();
+      });
+      if (stopping) return;
+      pending.swap(commands);
+      running = !paused;
+    }
+    for (auto& command : pending) command(table);
+    if (running) {
+      ProfileScope scope("Table::update");
+      auto start = std::chrono::steady_clock::now();
+      table.update();
+      calc_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                     std::chrono::steady_clock::now() - start)
+                     .count();
+      ++updates;
+    }
+    // while paused every command batch is shown, otherwise only generations
+    // the renderer is ready for
+    if (!pending.empty() || !(middle.load() & kFresh)) publish();
+    pending.clear();
+  }
+}
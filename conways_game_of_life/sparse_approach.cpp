@@ -0,0 +1,34 @@
+#include <SFML/Graphics.hpp>
+#include <chrono>
+#include <iostream>
+
+#include "game_of_life.hpp"
+#include "sparse_table.hpp"
+
+int main(int argc, char** argv) {
+  const unsigned int fps_max = 0;
+  GUI gui(fps_max);
+  SparseTable table(world_size(argc, argv, gui));
+  try {
+    if (const char* path = pattern_path(argc, argv)) load_pattern(table, path);
+  } catch (const std::exception& error) {
+    std::cerr << error.what() << '\n';
+    return 1;
+  }
+  gui.show_world(sf::Vector2u(table.width, table.height));
+  PixelSimulation<SparseTable> simulation(
+      table, capture_view<SparseTable>(gui));
+  Events<SparseTable> events(gui, simulation);
+
+  int frame_counter = 0;
+  while (gui.window.isOpen() && ++frame_counter <= 40) {
+    gui.display(simulation.acquire());
+    events.handle();
+  }
+  auto calc_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+      simulation.get_calc_time());
+  std::cout << gui.clock.getElapsedTime().asMilliseconds() << '\n';
+  std::cout << calc_time.count() << '\n';
+  std::cout << simulation.get_updates() << '\n';
+  return 0;
+}
@@ -0,0 +1,233 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <iterator>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "bit_life.hpp"
+
+// Unbounded plane made of 64x64 chunks (one word per chunk row, cell x of a
+// chunk is bit x) kept in a hash map by chunk coordinate. Before a generation
+// every chunk with live cells on its border gets the neighbours that border
+// touches, and after it chunks left empty are freed, so memory and time
+// follow the population. The window [0, width) x [0, height) is what the GUI
+// shows and what randomize() fills.
+class SparseTable {
+ public:
+  using Word = uint64_t;
+  static constexpr int kChunkSize = 64;
+
+  SparseTable(const sf::Vector2u&);
+  bool get_state(int, int) const;
+  void set_state(int, int, bool);
+  void clear();
+  void randomize();
+  void randomize(uint64_t seed);
+  void update();
+
+  size_t get_chunk_count() const { return chunks.size(); }
+  // calls f(i, j) for every live cell of the window
+  template <typename F>
+  void for_each_alive(F f) const {
+    for_each_alive_in(0, 0, width, height, f);
+  }
+  // The same for the cells of the window in [x0, x1) x [y0, y1). Looks up
+  // the chunks the clip covers, or walks all chunks if there are fewer.
+  template <typename F>
+  void for_each_alive_in(int x0, int y0, int x1, int y1, F f) const;
+
+  const int width;
+  const int height;
+
+ private:
+  struct Chunk {
+    std::array<Word, kChunkSize> cells{};
+    std::array<Word, kChunkSize> next{};
+  };
+
+  std::unordered_map<uint64_t, Chunk> chunks;
+  std::vector<uint64_t> border_keys;
+
+  static uint64_t key(int32_t cx, int32_t cy) {
+    return uint64_t(uint32_t(cx)) << 32 | uint32_t(cy);
+  }
+  static int32_t key_x(uint64_t k) { return int32_t(uint32_t(k >> 32)); }
+  static int32_t key_y(uint64_t k) { return int32_t(uint32_t(k)); }
+  static int32_t chunk_of(int i) {
+    return i >= 0 ? i / kChunkSize : -((kChunkSize - 1 - i) / kChunkSize);
+  }
+
+  const Chunk* find(int32_t, int32_t) const;
+  // calls f for the live cells of a chunk inside [x0, x1) x [y0, y1)
+  template <typename F>
+  static void visit(int32_t cx, int32_t cy, const Chunk&, int x0, int y0,
+                    int x1, int y1, F& f);
+  void fill_random(std::mt19937_64&);
+  void grow();
+  void step(int32_t, int32_t, Chunk&);
+};
+
+inline SparseTable::SparseTable(const sf::Vector2u& size)
+    : width(size.x), height(size.y) {
+  randomize();
+}
+
+inline bool SparseTable::get_state(int i, int j) const {
+  int32_t cx = chunk_of(i), cy = chunk_of(j);
+  const Chunk* chunk = find(cx, cy);
+  if (!chunk) return false;
+  return (chunk->cells[j - cy * kChunkSize] >> (i - cx * kChunkSize)) & 1;
+}
+
+inline void SparseTable::set_state(int i, int j, bool state) {
+  int32_t cx = chunk_of(i), cy = chunk_of(j);
+  if (!state && !find(cx, cy)) return;
+  Word& word = chunks[key(cx, cy)].cells[j - cy * kChunkSize];
+  Word bit = Word(1) << (i - cx * kChunkSize);
+  word = state ? word | bit : word & ~bit;
+}
+
+inline void SparseTable::clear() { chunks.clear(); }
+
+// same bit stream and cell order as the ImageCellTable::randomize()
+inline void SparseTable::randomize() {
+  static std::mt19937_64 rnd;
+  fill_random(rnd);
+}
+
+inline void SparseTable::randomize(uint64_t seed) {
+  std::mt19937_64 rnd(seed);
+  fill_random(rnd);
+}
+
+inline void SparseTable::fill_random(std::mt19937_64& rnd) {
+  chunks.clear();
+  const int words_per_row = (width + kChunkSize - 1) / kChunkSize;
+  const Word last_word_mask =
+      ~Word() >> (words_per_row * kChunkSize - width);
+  for (int j = 0; j < height; ++j) {
+    for (int k = 0; k < words_per_row; ++k) {
+      Word word = rnd();
+      if (k == words_per_row - 1) word &= last_word_mask;
+      if (word) chunks[key(k, j / kChunkSize)].cells[j % kChunkSize] = word;
+    }
+  }
+}
+
+inline void SparseTable::update() {
+  grow();
+  for (auto& item : chunks) {
+    step(key_x(item.first), key_y(item.first), item.second);
+  }
+  for (auto it = chunks.begin(); it != chunks.end();) {
+    Chunk& chunk = it->second;
+    chunk.cells.swap(chunk.next);
+    Word any = 0;
+    for (Word word : chunk.cells) any |= word;
+    it = any ? std::next(it) : chunks.erase(it);
+  }
+}
+
+template <typename F>
+void SparseTable::for_each_alive_in(int x0, int y0, int x1, int y1,
+                                    F f) const {
+  x0 = std::max(x0, 0), x1 = std::min(x1, width);
+  y0 = std::max(y0, 0), y1 = std::min(y1, height);
+  if (x0 >= x1 || y0 >= y1) return;
+  const int32_t cx0 = chunk_of(x0), cx1 = chunk_of(x1 - 1);
+  const int32_t cy0 = chunk_of(y0), cy1 = chunk_of(y1 - 1);
+  const uint64_t covered = uint64_t(cx1 - cx0 + 1) * (cy1 - cy0 + 1);
+  if (covered < chunks.size()) {
+    for (int32_t cy = cy0; cy <= cy1; ++cy) {
+      for (int32_t cx = cx0; cx <= cx1; ++cx) {
+        if (const Chunk* chunk = find(cx, cy)) {
+          visit(cx, cy, *chunk, x0, y0, x1, y1, f);
+        }
+      }
+    }
+    return;
+  }
+  for (const auto& item : chunks) {
+    const int32_t cx = key_x(item.first), cy = key_y(item.first);
+    if (cx >= cx0 && cx <= cx1 && cy >= cy0 && cy <= cy1) {
+      visit(cx, cy, item.second, x0, y0, x1, y1, f);
+    }
+  }
+}
+
+template <typename F>
+void SparseTable::visit(int32_t cx, int32_t cy, const Chunk& chunk, int x0,
+                        int y0, int x1, int y1, F& f) {
+  const int left = cx * kChunkSize, top = cy * kChunkSize;
+  const int r0 = std::max(y0 - top, 0);
+  const int r1 = std::min(y1 - top, kChunkSize);
+  for (int r = r0; r < r1; ++r) {
+    Word word = chunk.cells[r];
+    for (int i = left; word; ++i, word >>= 1) {
+      if ((word & 1) && i >= x0 && i < x1) f(i, top + r);
+    }
+  }
+}
+
+inline const SparseTable::Chunk* SparseTable::find(int32_t cx,
+                                                   int32_t cy) const {
+  auto it = chunks.find(key(cx, cy));
+  return it == chunks.end() ? nullptr : &it->second;
+}
+
+// allocates the neighbours that live border cells can spread into
+inline void SparseTable::grow() {
+  const Word west = 1, east = Word(1) << (kChunkSize - 1);
+  border_keys.clear();
+  for (const auto& item : chunks) {
+    const auto& cells = item.second.cells;
+    Word left = 0, right = 0;
+    for (Word word : cells) {
+      left |= word & west;
+      right |= word & east;
+    }
+    const Word top = cells.front(), bottom = cells.back();
+    const int32_t cx = key_x(item.first), cy = key_y(item.first);
+    if (top) border_keys.push_back(key(cx, cy - 1));
+    if (bottom) border_keys.push_back(key(cx, cy + 1));
+    if (left) border_keys.push_back(key(cx - 1, cy));
+    if (right) border_keys.push_back(key(cx + 1, cy));
+    if (top & west) border_keys.push_back(key(cx - 1, cy - 1));
+    if (top & east) border_keys.push_back(key(cx + 1, cy - 1));
+    if (bottom & west) border_keys.push_back(key(cx - 1, cy + 1));
+    if (bottom & east) border_keys.push_back(key(cx + 1, cy + 1));
+  }
+  for (uint64_t k : border_keys) chunks[k];
+}
+
+// Rows -1 and 64 come from the chunks above and below, and bits -1 and 64
+// of every row from the chunks to the sides; missing chunks are empty.
+inline void SparseTable::step(int32_t cx, int32_t cy, Chunk& chunk) {
+  const Chunk* around[3][3];
+  for (int dy = -1; dy <= 1; ++dy) {
+    for (int dx = -1; dx <= 1; ++dx) {
+      around[dy + 1][dx + 1] =
+          dx || dy ? find(cx + dx, cy + dy) : &chunk;
+    }
+  }
+  auto word_at = [&around](int column, int r) -> Word {
+    int band = r < 0 ? 0 : (r < kChunkSize ? 1 : 2);
+    const Chunk* source = around[band][column];
+    return source ? source->cells[(r + kChunkSize) % kChunkSize] : 0;
+  };
+  Word w[3] = {}, c[3] = {}, e[3] = {};
+  for (int r = -1; r <= kChunkSize; ++r) {
+    // slide the three-row window down by one row
+    w[0] = w[1], c[0] = c[1], e[0] = e[1];
+    w[1] = w[2], c[1] = c[2], e[1] = e[2];
+    c[2] = word_at(1, r);
+    w[2] = (c[2] << 1) | (word_at(0, r) >> (kChunkSize - 1));
+    e[2] = (c[2] >> 1) | (word_at(2, r) << (kChunkSize - 1));
+    if (r >= 1) chunk.next[r - 1] = next_bits(w, c, e);
+  }
+}
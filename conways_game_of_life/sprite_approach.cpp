@@ -1,227 +1,165 @@
 #include <SFML/Graphics.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstring>
 #include <iostream>
-#include <random>
-#include <vector>
-
-class CellTable {
+#include <memory>
+#include <string>
+
+#include "cycle_detector.hpp"
+#include "game_of_life.hpp"
+#include "image_cell_table.hpp"
+#include "recorder.hpp"
+
+// Feeds the board hash of every update to a CycleDetector and raises a flag
+// once the board settles into a still life or oscillator. Any edit re-arms
+// the detector. With a Recorder attached, the image, which is the raw cell
+// state, is also handed to it after every update.
+class WatchedTable : public ImageCellTable {
  public:
-  CellTable(const sf::Vector2u&);
-  const sf::Image& get_image() const { return image; }
-  bool get_state(int, int) const;
-  void set_state(int, int, bool);
-  void clear();
-  void randomize();
-  void update();
-
-  const int width;
-  const int height;
-
- private:
-  sf::Image image;
-  uint32_t* image_ptr;
-  std::vector<uint8_t> neighbors;
-
-  void fix_neighbors(int, int);
-};
+  using ImageCellTable::ImageCellTable;
 
-struct GUI {
-  sf::RenderWindow window;
-  sf::Texture texture;
-  sf::Sprite sprite;
-  const sf::Clock clock;
-  const float cell_size;
-  const unsigned int fps_max;
-  bool is_paused;
-  // window(sf::VideoMode(x, y), "Conway's Game of Life")
-
-  GUI(float cell_size, unsigned int fps_max);
-  void display(const CellTable&);
-};
-
-class Events {
- public:
-  Events(GUI& gui, CellTable& table) : gui(gui), table(table) {}
-  void handle();
+  void update();
+  void set_state(int i, int j, bool state) {
+    ImageCellTable::set_state(i, j, state);
+    rearm();
+  }
+  void clear() {
+    ImageCellTable::clear();
+    rearm();
+  }
+  void randomize() {
+    ImageCellTable::randomize();
+    rearm();
+  }
+  void set_rule(const Rule& rule) {
+    ImageCellTable::set_rule(rule);
+    rearm();
+  }
+  // called from the render thread: true once per detected cycle
+  bool take_cycle(uint64_t& period, uint64_t& at);
+  // records the current state and every update after it; nullptr stops
+  void set_recorder(Recorder* next) {
+    recorder = next;
+    if (recorder) record();
+  }
 
  private:
-  sf::Event event;
-  GUI& gui;
-  CellTable& table;
-
-  void handle_keyboard();
-  void handle_mouse();
+  CycleDetector cycles;
+  Recorder* recorder = nullptr;
+  bool armed = true;
+  uint64_t generation = 0;
+  uint64_t found_period = 0;
+  uint64_t found_at = 0;
+  std::atomic<bool> settled{false};
+
+  void rearm() {
+    cycles.reset();
+    armed = true;
+  }
+  void record() {
+    recorder->push(
+        reinterpret_cast<const uint32_t*>(get_image().getPixelsPtr()),
+        generation);
+  }
 };
 
-int main() {
-  const unsigned int cell_size = 1, fps_max = 0;
-  GUI gui(cell_size, fps_max);
-  CellTable table(gui.window.getSize() / cell_size);
-  Events events(gui, table);
-
-  sf::Time calc_time;
-  sf::Clock cl;
-
-  int frame_counter = 0;
-  while (gui.window.isOpen() && ++frame_counter <= 40) {
-    gui.display(table);
-    events.handle();
-
-    cl.restart();
-
-    if (!gui.is_paused) table.update();
-
-    calc_time += cl.getElapsedTime();
+void WatchedTable::update() {
+  ImageCellTable::update();
+  generation += get_time_block();
+  if (recorder) record();
+  if (!armed) return;
+  if (uint64_t period = cycles.observe(get_hash(), generation)) {
+    armed = false;
+    found_period = period;
+    found_at = generation;
+    settled.store(true, std::memory_order_release);
   }
-  std::cout << gui.clock.getElapsedTime().asMilliseconds() << '\n';
-  std::cout << calc_time.asMilliseconds() << '\n';
-  return 0;
-}
-/*
- * Hotkeys:
- *  Escape   (close)
- *  C        (clear)
- *  N        (new table with random cells)
- *  P        (pause and show mouse coursor)
- *  F        (unlock fps)
- */
-
-CellTable::CellTable(
-    const sf::Vector2u& size) : width(size.x),
-                                height(size.y),
-                                neighbors(size.x * size.y) {
-  image.create(size.x, size.y);
-  image_ptr = reinterpret_cast<uint32_t*>(
-      const_cast<sf::Uint8*>(image.getPixelsPtr()));
-  randomize();
 }
 
-bool CellTable::get_state(int i, int j) const {
-  //return image.getPixel(i, j) == sf::Color::White;
-  return image_ptr[i + j * width] == 0xFFFFFFFF;
+bool WatchedTable::take_cycle(uint64_t& period, uint64_t& at) {
+  if (!settled.exchange(false, std::memory_order_acquire)) return false;
+  period = found_period;
+  at = found_at;
+  return true;
 }
 
-void CellTable::set_state(int i, int j, bool state) {
-  //image.setPixel(i, j, (state ? sf::Color::White : sf::Color::Black));
-  image_ptr[i + j * width] = state ? 0xFFFFFFFF : 0xFF000000;
+// The table already is an image, so a frame is a plain copy of its pixels
+// plus the tiles that changed since the previous frame.
+void capture_image(ImageCellTable& table, PixelFrame& frame) {
+  static uint64_t serial = 0;
+  frame.width = table.width;
+  frame.height = table.height;
+  frame.pixels.resize(frame.width * frame.height);
+  std::memcpy(frame.pixels.data(), table.get_image().getPixelsPtr(),
+              frame.pixels.size() * sizeof(uint32_t));
+  frame.has_dirty = true;
+  frame.serial = ++serial;
+  frame.dirty.clear();
+  table.take_dirty_rects(frame.dirty);
 }
 
-void CellTable::clear() {
-  image.create(image.getSize().x, image.getSize().y);
-}
-
-void CellTable::randomize() {
-  static std::mt19937_64 rnd;
-  uint64_t num = 0;
-  for (int j = 0; j < height; ++j) {
-    for (int i = 0; i < width; ++i, num >>= 1) {
-      if ((i & 0x3F) == 0) num = rnd();
-      set_state(i, j, num & 1);
+// Extra command line options: --record frames.png|frames.raw writes every
+// generation, see Recorder, and --record-overflow drop|block says what to
+// do when the disk falls behind (default drop).
+int main(int argc, char** argv) {
+  const char* record_path = take_option(argc, argv, "--record");
+  const char* overflow = take_option(argc, argv, "--record-overflow");
+  const unsigned int fps_max = 0;
+  GUI gui(fps_max);
+  WatchedTable table(world_size(argc, argv, gui));
+  try {
+    if (const char* path = pattern_path(argc, argv)) {
+      table.set_rule(Rule::parse(load_pattern(table, path)));
     }
+  } catch (const std::exception& error) {
+    std::cerr << error.what() << '\n';
+    return 1;
   }
-}
-
-void CellTable::update() {
-  std::fill(neighbors.begin(), neighbors.end(), uint8_t());
-  for (int j = 0; j < height; ++j) {
-    for (int i = 0; i < width; ++i) {
-      if (get_state(i, j)) fix_neighbors(i, j);
-    }
+  // declared before the simulation, so it outlives the thread that feeds it
+  std::unique_ptr<Recorder> recorder;
+  if (record_path) {
+    const bool block = overflow && std::string(overflow) == "block";
+    recorder.reset(new Recorder(
+        record_path, sf::Vector2u(table.width, table.height),
+        block ? Recorder::Overflow::kBlock : Recorder::Overflow::kDrop));
+    table.set_recorder(recorder.get());
   }
-  for (int j = 0; j < height; ++j) {
-    for (int i = 0; i < width; ++i) {
-      int index = i + j * width;
-      if (get_state(i, j)) {
-        if (neighbors[index] < 2 || neighbors[index] > 3) {
-          set_state(i, j, false);
+  gui.show_world(sf::Vector2u(table.width, table.height));
+  // the image is only usable as is while it maps 1:1 onto the screen
+  PixelSimulation<WatchedTable> simulation(
+      table, [&gui](WatchedTable& table, PixelFrame& frame) {
+        const Viewport view = gui.shared_view.load();
+        if (view.x == 0 && view.y == 0 && view.zoom == 0 &&
+            gui.screen == sf::Vector2u(table.width, table.height)) {
+          capture_image(table, frame);
+        } else {
+          render_view(table, view, gui.screen, frame);
         }
-      } else if (neighbors[index] == 3) {
-        set_state(i, j, true);
-      }
-    }
-  }
-}
-
-void CellTable::fix_neighbors(int i, int j) {
-  const int offsets[8][2] = {
-      {-1, -1}, {0, -1}, {1, -1}, {-1, 0}, {1, 0}, {-1, 1}, {0, 1}, {1, 1}};
-  for (auto offset : offsets) {
-    int io = i + offset[0];
-    int jo = j + offset[1];
-    if (io < 0) io += width;
-    if (io >= width) io -= width;
-    if (jo < 0) jo += height;
-    if (jo >= height) jo -= height;
-    ++neighbors[io + jo * width];
-  }
-}
-
-GUI::GUI(float cell_size, unsigned int fps_max)
-    : window(sf::VideoMode(sf::VideoMode::getDesktopMode()),
-             "Conway's Game of Life", sf::Style::Fullscreen),
-      sprite(),
-      cell_size(cell_size),
-      fps_max(fps_max),
-      is_paused(false) {
-  window.setFramerateLimit(fps_max);
-  window.setMouseCursorVisible(false);
-  sprite.setScale({cell_size, cell_size});
-}
+      });
+  Events<WatchedTable> events(gui, simulation);
 
-void GUI::display(const CellTable& table) {
-  window.clear();
-  texture.loadFromImage(table.get_image());
-  sprite.setTexture(texture, false);
-  window.draw(sprite);
-  window.display();
-}
-
-void Events::handle() {
-  while (gui.window.pollEvent(event)) {
-    switch (event.type) {
-      case sf::Event::Closed:
-        gui.window.close();
-        break;
-      case sf::Event::KeyPressed:
-        handle_keyboard();
-        break;
-      case sf::Event::MouseButtonPressed: {
-        handle_mouse();
-        break;
-      }
-      default:
-        break;
+  int frame_counter = 0;
+  uint64_t period, at;
+  while (gui.window.isOpen() && ++frame_counter <= 40) {
+    gui.display(simulation.acquire());
+    events.handle();
+    // a settled board only repeats itself, so stop there
+    if (table.take_cycle(period, at)) {
+      std::cout << (period == 1 ? "still life" : "period " +
+                    std::to_string(period) + " oscillator")
+                << " at generation " << at << '\n';
+      events.set_paused(true);
     }
   }
-}
-
-void Events::handle_keyboard() {
-  switch (event.key.code) {
-    case sf::Keyboard::Escape:
-      gui.window.close();
-      break;
-    case sf::Keyboard::N:
-      table.randomize();
-      break;
-    case sf::Keyboard::C:
-      table.clear();
-      break;
-    case sf::Keyboard::F:
-      static bool unlocked = false;
-      unlocked = !unlocked;
-      gui.window.setFramerateLimit(unlocked ? 0 : gui.fps_max);
-      break;
-    case sf::Keyboard::P:
-      gui.is_paused = !gui.is_paused;
-      gui.window.setMouseCursorVisible(gui.is_paused);
-      break;
-    default:
-      break;
+  auto calc_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+      simulation.get_calc_time());
+  std::cout << gui.clock.getElapsedTime().asMilliseconds() << '\n';
+  std::cout << calc_time.count() << '\n';
+  std::cout << simulation.get_updates() << '\n';
+  if (recorder) {
+    std::cout << recorder->get_written() << " frames recorded, "
+              << recorder->get_dropped() << " dropped\n";
   }
-}
-
-void Events::handle_mouse() {
-  sf::Vector2i p = sf::Mouse::getPosition() - gui.window.getPosition();
-  int x = p.x / static_cast<int>(gui.cell_size);
-  int y = p.y / static_cast<int>(gui.cell_size);
-  table.set_state(x, y, !table.get_state(x, y));
+  return 0;
 }
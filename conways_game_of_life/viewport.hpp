@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+
+// Part of the world shown in the window: cell (x, y) sits at the top left
+// corner, and a pixel covers 2^zoom x 2^zoom cells when zoom >= 0, while a
+// cell covers 2^-zoom x 2^-zoom pixels when zoom < 0.
+struct Viewport {
+  static constexpr int kMinZoom = -5;
+  static constexpr int kMaxZoom = 10;
+
+  int x = 0;
+  int y = 0;
+  int zoom = 0;
+
+  // cells spanned by the given number of pixels
+  int scale(int pixels) const {
+    return zoom >= 0 ? pixels << zoom : pixels >> -zoom;
+  }
+  // first cell under pixel column px, pixel row py
+  int cell_x(int px) const { return x + scale(px); }
+  int cell_y(int py) const { return y + scale(py); }
+};
+
+// Colour of a pixel that covers `cells` cells of the world, `alive` of them
+// live; pixels off the world (cells == 0) are dark grey.
+inline uint32_t density_color(int alive, int cells) {
+  if (cells == 0) return 0xFF202020;
+  uint32_t level = 255 * alive / cells;
+  return 0xFF000000 | level * 0x010101;
+}
+
+// Hands the viewport from the render thread to the simulation thread
+class SharedViewport {
+ public:
+  void store(const Viewport& view) {
+    std::lock_guard<std::mutex> lock(mutex);
+    viewport = view;
+  }
+  Viewport load() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return viewport;
+  }
+
+ private:
+  mutable std::mutex mutex;
+  Viewport viewport;
+};
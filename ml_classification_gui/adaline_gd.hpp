@@ -2,16 +2,21 @@
 #include <random>
 #include <vector>
 
+#include "features.hpp"
+
 // adaptive linear neuron with gradient descent
 template <size_t kFeatures>
 class AdalineGD {
    public:
     AdalineGD(float eta = 0.01f, uint32_t random_state = 0);
     void initialize();
-    void fit(const std::vector<std::array<float, kFeatures>>& x,
+    void fit(const std::array<std::vector<float>, kFeatures>& x,
              const std::vector<int>& y, uint32_t n_iter = 1);
     int predict(const std::array<float, kFeatures>& x) const;
     const std::vector<float>& getLosses() const { return cost_; }
+    // one weight per feature, then the bias
+    const std::array<float, kFeatures + 1>& getWeights() const { return w_; }
+    void setWeights(const std::array<float, kFeatures + 1>& w) { w_ = w; }
 
    private:
     std::array<float, kFeatures + 1> w_;
@@ -19,9 +24,18 @@ class AdalineGD {
     float eta;
     std::mt19937 gen_;
 
-    float updateWeights(const std::vector<std::array<float, kFeatures>>& x,
+    // samples per batch of the kernel, a multiple of the SIMD width
+    static constexpr size_t kLanes = 32;
+
+    // Full-batch step. Batches of kLanes samples are computed lane by lane,
+    // each lane with its own sums, which the compiler keeps in vector
+    // registers; the lanes are only added up at the end of the pass.
+    float updateWeights(const std::array<std::vector<float>, kFeatures>& x,
                         const std::vector<int>& y);
     float netInput(const std::array<float, kFeatures>& x) const;
+    // net[l] = netInput of sample i + l, for l < kLanes
+    void netInputBatch(const std::array<const float*, kFeatures>& x, size_t i,
+                       float* net) const;
     float activation(float x) const { return x; }
 };
 
@@ -42,10 +56,10 @@ void AdalineGD<kFeatures>::initialize() {
 
 template <size_t kFeatures>
 void AdalineGD<kFeatures>::fit(
-    const std::vector<std::array<float, kFeatures>>& x,
+    const std::array<std::vector<float>, kFeatures>& x,
     const std::vector<int>& y, uint32_t n_iter) {
     for (uint32_t n = 0; n < n_iter; ++n) {
-        cost_.push_back(updateWeights(x, y) / static_cast<float>(x.size()));
+        cost_.push_back(updateWeights(x, y) / static_cast<float>(y.size()));
     }
 }
 
@@ -56,23 +70,54 @@ int AdalineGD<kFeatures>::predict(const std::array<float, kFeatures>& x) const {
 
 template <size_t kFeatures>
 float AdalineGD<kFeatures>::updateWeights(
-    const std::vector<std::array<float, kFeatures>>& x,
+    const std::array<std::vector<float>, kFeatures>& x,
     const std::vector<int>& y) {
-    float sum = 0, sum_sq = 0;
-    std::array<float, kFeatures> delta = {0};
-    for (size_t i = 0; i != x.size(); ++i) {
-        float error = static_cast<float>(y[i]) - activation(netInput(x[i]));
-        sum += error;
-        sum_sq += error * error;
+    std::array<const float*, kFeatures> columns;
+    for (size_t j = 0; j != kFeatures; ++j) {
+        columns[j] = x[j].data();
+    }
+    const int* labels = y.data();
+    const size_t n = y.size(), batched = n - n % kLanes;
+    float sum[kLanes] = {0}, sum_sq[kLanes] = {0};
+    float delta[kFeatures][kLanes] = {};
+    for (size_t i = 0; i != batched; i += kLanes) {
+        float error[kLanes];
+        netInputBatch(columns, i, error);
+        for (size_t l = 0; l != kLanes; ++l) {
+            error[l] = static_cast<float>(labels[i + l]) - activation(error[l]);
+            sum[l] += error[l];
+            sum_sq[l] += error[l] * error[l];
+        }
         for (size_t j = 0; j != kFeatures; ++j) {
-            delta[j] += x[i][j] * error;
+            for (size_t l = 0; l != kLanes; ++l) {
+                delta[j][l] += columns[j][i + l] * error[l];
+            }
         }
     }
+    // the rest one by one, into lane 0
+    for (size_t i = batched; i != n; ++i) {
+        float error = static_cast<float>(labels[i]) -
+                      activation(netInput(sampleAt(x, i)));
+        sum[0] += error;
+        sum_sq[0] += error * error;
+        for (size_t j = 0; j != kFeatures; ++j) {
+            delta[j][0] += columns[j][i] * error;
+        }
+    }
+    float total = 0, total_sq = 0;
+    for (size_t l = 0; l != kLanes; ++l) {
+        total += sum[l];
+        total_sq += sum_sq[l];
+    }
     for (size_t j = 0; j != kFeatures; ++j) {
-        w_[j] += eta * delta[j];
+        float total_delta = 0;
+        for (size_t l = 0; l != kLanes; ++l) {
+            total_delta += delta[j][l];
+        }
+        w_[j] += eta * total_delta;
     }
-    w_[kFeatures] += eta * sum;
-    return sum_sq * 0.5f;
+    w_[kFeatures] += eta * total;
+    return total_sq * 0.5f;
 }
 
 template <size_t kFeatures>
@@ -84,3 +129,16 @@ float AdalineGD<kFeatures>::netInput(
     }
     return result;
 }
+
+template <size_t kFeatures>
+void AdalineGD<kFeatures>::netInputBatch(
+    const std::array<const float*, kFeatures>& x, size_t i, float* net) const {
+    for (size_t l = 0; l != kLanes; ++l) {
+        net[l] = w_[kFeatures];
+    }
+    for (size_t j = 0; j != kFeatures; ++j) {
+        for (size_t l = 0; l != kLanes; ++l) {
+            net[l] += x[j][i + l] * w_[j];
+        }
+    }
+}
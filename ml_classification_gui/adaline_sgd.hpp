@@ -4,17 +4,22 @@
 #include <random>
 #include <vector>
 
+#include "features.hpp"
+
 // adaptive linear neuron with stochastic gradient descent
 template <size_t kFeatures>
 class AdalineSGD {
    public:
     AdalineSGD(float eta = 0.01f, uint32_t random_state = 0);
     void initialize();
-    void fit(const std::vector<std::array<float, kFeatures>>& x,
+    void fit(const std::array<std::vector<float>, kFeatures>& x,
              const std::vector<int>& y, uint32_t n_iter = 1);
     void partialFit(const std::array<float, kFeatures>& x, int y);
     int predict(const std::array<float, kFeatures>& x) const;
     const std::vector<float>& getLosses() const { return cost_; }
+    // one weight per feature, then the bias
+    const std::array<float, kFeatures + 1>& getWeights() const { return w_; }
+    void setWeights(const std::array<float, kFeatures + 1>& w) { w_ = w; }
 
    private:
     std::array<float, kFeatures + 1> w_;
@@ -44,17 +49,17 @@ void AdalineSGD<kFeatures>::initialize() {
 
 template <size_t kFeatures>
 void AdalineSGD<kFeatures>::fit(
-    const std::vector<std::array<float, kFeatures>>& x,
+    const std::array<std::vector<float>, kFeatures>& x,
     const std::vector<int>& y, uint32_t n_iter) {
-    std::vector<size_t> indexes(x.size());
+    std::vector<size_t> indexes(y.size());
     std::iota(indexes.begin(), indexes.end(), 0);
     for (uint32_t n = 0; n < n_iter; ++n) {
         std::shuffle(indexes.begin(), indexes.end(), gen_);
         float cost = 0;
         for (auto i : indexes) {
-            cost += updateWeights(x[i], y[i]);
+            cost += updateWeights(sampleAt(x, i), y[i]);
         }
-        cost_.push_back(cost / static_cast<float>(x.size()));
+        cost_.push_back(cost / static_cast<float>(y.size()));
     }
 }
 
@@ -9,13 +9,23 @@
  *  Numpad2  (set active color to red)
  *  MouseL   (add point)
  *  MouseR   (remove point)
+ *  O        (show section timings)
+ *  T        (write the recorded timings to trace.json)
  */
 
 #include <SFML/Graphics.hpp>
 #include <array>
 #include <iostream>
+#include <memory>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#include "../common/profiler.hpp"
+#include "dataset.hpp"
+#include "decision_map.hpp"
+#include "trainer.hpp"
+
 class Window : public sf::RenderWindow {
    public:
     Window(uint32_t fps_max);
@@ -34,18 +44,32 @@ class Processing {
     void removePoint(sf::Vector2f);
     void clear();
     void update(uint32_t eras);
+    void toggleOverlay() { overlay_.toggle(); }
 
    private:
     Window& window;
-    Classifier classifier_;
-    std::vector<sf::Vector2f> points_pos_;
-    std::vector<int> points_category_;  // is binary ([-1, 1])
+    Trainer<Classifier> trainer_;
+    Classifier classifier_;  // the one the trainer published last
+    ProfileOverlay overlay_;
+    Dataset points_;  // in step with the trainer's
     const float pointRadius;
+    sf::Vector2u drawnSize_;  // of the background
+    sf::VertexArray halfPlanes_;
+    std::unique_ptr<DecisionMap> map_;  // created when first needed
 
     std::array<float, 2> posScaled(sf::Vector2f) const;
-    void trainClassifier(uint32_t eras);
     int predict(sf::Vector2u) const;
-    void drawBackground() const;
+    // renders the background again if the classifier or window changed
+    void drawBackground(bool changed);
+    // Linear classifiers in the plane return two weights and a bias from
+    // getWeights(), so their boundary is a line and the background is two
+    // half-planes. Any other classifier is rasterized by the decision map.
+    template <typename C>
+    auto renderBackground(const C& classifier, int) -> std::enable_if_t<
+        std::is_same<std::decay_t<decltype(classifier.getWeights())>,
+                     std::array<float, 3>>::value>;
+    template <typename C>
+    void renderBackground(const C& classifier, long);
     void drawForeground() const;
 };
 
@@ -82,40 +106,45 @@ void Window::toggleFpsLock() {
 template <typename Classifier>
 Processing<Classifier>::Processing(Window& window, float learning_rate,
                                    float point_radius)
-    : window(window), classifier_(learning_rate), pointRadius(point_radius) {}
+    : window(window),
+      trainer_(learning_rate, window.getSize()),
+      classifier_(learning_rate),
+      points_(window.getSize(), 2 * point_radius),
+      pointRadius(point_radius) {}
 
 template <typename Classifier>
 void Processing<Classifier>::addPoint(sf::Vector2f pos, int category) {
-    points_pos_.push_back({pos.x, pos.y});
-    points_category_.push_back(category);
+    points_.add(pos, category);
+    trainer_.add(pos, category);
 }
 
 template <typename Classifier>
 void Processing<Classifier>::removePoint(sf::Vector2f pos) {
-    auto sq = [](float x) { return x * x; };
-    for (size_t i = 0; i < points_pos_.size(); ++i) {
-        if (sq(pointRadius) >
-            sq(points_pos_[i].x - pos.x) + sq(points_pos_[i].y - pos.y)) {
-            ptrdiff_t i_ = static_cast<ptrdiff_t>(i);
-            points_pos_.erase(points_pos_.begin() + i_);
-            points_category_.erase(points_category_.begin() + i_);
-        }
+    for (size_t i : points_.within(pos, pointRadius)) {
+        points_.remove(i);
+        trainer_.remove(i);
     }
 }
 
 template <typename Classifier>
 void Processing<Classifier>::clear() {
-    points_pos_.clear();
-    points_category_.clear();
-    classifier_.initialize();
+    points_.clear();
+    trainer_.clear();
 }
 
 template <typename Classifier>
 void Processing<Classifier>::update(uint32_t eras) {
-    trainClassifier(eras);
+    if (window.getSize() != points_.getWindowSize()) {
+        points_.resize(window.getSize());
+        trainer_.resize(window.getSize());
+    }
+    trainer_.train(eras);
+    const bool changed = trainer_.refresh(classifier_);
     window.clear();
-    drawBackground();
+    drawBackground(changed);
     drawForeground();
+    overlay_.draw(window);
+    ProfileScope scope("window.display");
     window.display();
 }
 
@@ -125,15 +154,6 @@ std::array<float, 2> Processing<Classifier>::posScaled(sf::Vector2f pos) const {
     return {2 * pos.x / scale.x - 1, 2 * pos.y / scale.y - 1};
 }
 
-template <typename Classifier>
-void Processing<Classifier>::trainClassifier(uint32_t eras) {
-    std::vector<std::array<float, 2>> points_pos_scaled(points_pos_.size());
-    for (size_t i = 0; i != points_pos_.size(); ++i) {
-        points_pos_scaled[i] = posScaled(points_pos_[i]);
-    }
-    classifier_.fit(points_pos_scaled, points_category_, eras);
-}
-
 template <typename Classifier>
 int Processing<Classifier>::predict(sf::Vector2u pos) const {
     return classifier_.predict(
@@ -141,39 +161,80 @@ int Processing<Classifier>::predict(sf::Vector2u pos) const {
 }
 
 template <typename Classifier>
-void Processing<Classifier>::drawBackground() const {
-    sf::VertexArray line(sf::Lines, 2);
-    sf::Vector2u size = window.getSize();
-    for (uint32_t i = 0; i != size.y; ++i) {
-        int category = predict({0, i});
-        line[0].position = {0, static_cast<float>(i)};
-        line[0].color = line[1].color =
-            category == 1 ? sf::Color::Magenta : sf::Color::Cyan;
-        if (category != predict({size.x - 1, i})) {
-            uint32_t l = 0, r = size.x, m;
-            while (r - l > 1) {
-                m = (l + r) / 2;
-                (category == predict({m, i}) ? l : r) = m;
-            }
-            line[1].position = {static_cast<float>(l), static_cast<float>(i)};
-            window.draw(line);
-            std::swap(line[0].position, line[1].position);
-            line[0].color = line[1].color =
-                !(category == 1) ? sf::Color::Magenta : sf::Color::Cyan;
+void Processing<Classifier>::drawBackground(bool changed) {
+    ProfileScope scope("drawBackground");
+    if (changed || window.getSize() != drawnSize_) {
+        renderBackground(classifier_, 0);
+        drawnSize_ = window.getSize();
+    }
+    if (map_) {
+        map_->draw(window);
+    } else {
+        window.draw(halfPlanes_);
+    }
+}
+
+// In window coordinates the net input is a * x + b * y + c. Walking the
+// window's corners, every corner goes to the polygon of its side and every
+// edge crossing the boundary adds the crossing to both; each polygon is then
+// a convex fan of at most five vertices.
+template <typename Classifier>
+template <typename C>
+auto Processing<Classifier>::renderBackground(const C& classifier, int)
+    -> std::enable_if_t<
+        std::is_same<std::decay_t<decltype(classifier.getWeights())>,
+                     std::array<float, 3>>::value> {
+    const auto& w = classifier.getWeights();
+    sf::Vector2f size(static_cast<sf::Vector2f>(window.getSize()));
+    const double a = 2.0 * w[0] / size.x, b = 2.0 * w[1] / size.y,
+                 c = static_cast<double>(w[2]) - w[0] - w[1];
+    auto net = [&](sf::Vector2f p) { return a * p.x + b * p.y + c; };
+    const sf::Vector2f corners[4] = {
+        {0, 0}, {size.x, 0}, {size.x, size.y}, {0, size.y}};
+    std::vector<sf::Vector2f> positive, negative;
+    for (int k = 0; k != 4; ++k) {
+        const sf::Vector2f p = corners[k], q = corners[(k + 1) % 4];
+        const double np = net(p), nq = net(q);
+        (np >= 0 ? positive : negative).push_back(p);
+        if ((np >= 0) != (nq >= 0)) {
+            const float t = static_cast<float>(np / (np - nq));
+            positive.push_back(p + t * (q - p));
+            negative.push_back(positive.back());
         }
-        line[1].position = {static_cast<float>(size.x - 1),
-                            static_cast<float>(i)};
-        window.draw(line);
     }
+    halfPlanes_.clear();
+    halfPlanes_.setPrimitiveType(sf::Triangles);
+    auto fan = [this](const std::vector<sf::Vector2f>& polygon,
+                      sf::Color color) {
+        for (size_t k = 2; k < polygon.size(); ++k) {
+            halfPlanes_.append(sf::Vertex(polygon[0], color));
+            halfPlanes_.append(sf::Vertex(polygon[k - 1], color));
+            halfPlanes_.append(sf::Vertex(polygon[k], color));
+        }
+    };
+    fan(positive, sf::Color::Magenta);
+    fan(negative, sf::Color::Cyan);
+}
+
+template <typename Classifier>
+template <typename C>
+void Processing<Classifier>::renderBackground(const C&, long) {
+    if (!map_) {
+        map_.reset(new DecisionMap());
+    }
+    map_->render(window.getSize(),
+                 [this](sf::Vector2u pos) { return predict(pos); });
 }
 
 template <typename Classifier>
 void Processing<Classifier>::drawForeground() const {
+    ProfileScope scope("drawForeground");
     static sf::CircleShape shape_(pointRadius);
-    for (size_t i = 0; i != points_pos_.size(); ++i) {
-        shape_.setFillColor(points_category_[i] == 1 ? sf::Color::Red
-                                                     : sf::Color::Blue);
-        shape_.setPosition(points_pos_[i] -
+    const std::vector<int>& categories = points_.getCategories();
+    for (size_t i = 0; i != points_.size(); ++i) {
+        shape_.setFillColor(categories[i] == 1 ? sf::Color::Red
+                                               : sf::Color::Blue);
+        shape_.setPosition(points_.getPosition(i) -
                            sf::Vector2f(pointRadius, pointRadius));
         window.draw(shape_);
     }
@@ -181,6 +242,7 @@ void Processing<Classifier>::drawForeground() const {
 
 template <typename Classifier>
 void Events<Classifier>::handle() {
+    ProfileScope scope("Events::handle");
     while (window.pollEvent(event)) {
         switch (event.type) {
             case sf::Event::Closed:
@@ -222,6 +284,14 @@ void Events<Classifier>::handleKeyboard() {
         case sf::Keyboard::Numpad2:
             point_category_ = 1;
             break;
+        case sf::Keyboard::O:
+            processing_.toggleOverlay();
+            break;
+        case sf::Keyboard::T:
+            if (!Profiler::get().write_chrome_trace("trace.json")) {
+                std::cerr << "cannot write trace.json\n";
+            }
+            break;
         default:
             break;
     }
@@ -0,0 +1,169 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Labelled points in structure-of-arrays form: the window position of each
+// point, for drawing and hit-testing, and its features scaled to [-1, 1],
+// for training. The features are only rescaled when the window size
+// changes. remove() moves the last point into the hole, so indices change
+// on removal but stay the same for every Dataset given the same calls.
+//
+// A uniform grid of cellSize x cellSize cells over the window lists the
+// points of each cell, so a radius query only visits the cells it
+// overlaps.
+class Dataset {
+   public:
+    Dataset(sf::Vector2u window_size, float cell_size);
+    size_t size() const { return categories_.size(); }
+    void add(sf::Vector2f pos, int category);
+    void remove(size_t index);
+    void clear();
+    void resize(sf::Vector2u window_size);
+    // indices of the points closer than radius to pos, in descending order,
+    // so that removing them one by one never moves one still to be removed
+    std::vector<size_t> within(sf::Vector2f pos, float radius) const;
+
+    sf::Vector2u getWindowSize() const { return windowSize_; }
+    sf::Vector2f getPosition(size_t i) const { return {xs_[i], ys_[i]}; }
+    const std::vector<int>& getCategories() const { return categories_; }
+    // one array per feature
+    const std::array<std::vector<float>, 2>& getFeatures() const {
+        return features_;
+    }
+
+   private:
+    sf::Vector2u windowSize_;
+    const float cellSize_;
+    uint32_t columns_, rows_;
+    std::vector<float> xs_, ys_;
+    std::array<std::vector<float>, 2> features_;
+    std::vector<int> categories_;  // is binary ([-1, 1])
+    std::vector<std::vector<uint32_t>> cells_;  // point indices per cell
+    std::vector<uint32_t> cell_;  // the cell of each point
+    std::vector<uint32_t> slot_;  // its position in the list of that cell
+
+    // the grid column or row of coordinate v, clamped to [0, n)
+    uint32_t clampCell(float v, uint32_t n) const;
+    uint32_t cellOf(float x, float y) const;
+    void buildGrid();
+};
+
+Dataset::Dataset(sf::Vector2u window_size, float cell_size)
+    : windowSize_(window_size), cellSize_(std::max(cell_size, 1.0f)) {
+    buildGrid();
+}
+
+void Dataset::add(sf::Vector2f pos, int category) {
+    const uint32_t index = static_cast<uint32_t>(size()),
+                   cell = cellOf(pos.x, pos.y);
+    xs_.push_back(pos.x);
+    ys_.push_back(pos.y);
+    features_[0].push_back(2 * pos.x / windowSize_.x - 1);
+    features_[1].push_back(2 * pos.y / windowSize_.y - 1);
+    categories_.push_back(category);
+    cell_.push_back(cell);
+    slot_.push_back(static_cast<uint32_t>(cells_[cell].size()));
+    cells_[cell].push_back(index);
+}
+
+void Dataset::remove(size_t index) {
+    // take the point out of its cell, moving the cell's last entry in
+    std::vector<uint32_t>& list = cells_[cell_[index]];
+    const uint32_t moved = list.back();
+    list[slot_[index]] = moved;
+    slot_[moved] = slot_[index];
+    list.pop_back();
+    // then move the last point into its place
+    const size_t last = size() - 1;
+    if (index != last) {
+        xs_[index] = xs_[last];
+        ys_[index] = ys_[last];
+        features_[0][index] = features_[0][last];
+        features_[1][index] = features_[1][last];
+        categories_[index] = categories_[last];
+        cell_[index] = cell_[last];
+        slot_[index] = slot_[last];
+        cells_[cell_[index]][slot_[index]] = static_cast<uint32_t>(index);
+    }
+    xs_.pop_back();
+    ys_.pop_back();
+    features_[0].pop_back();
+    features_[1].pop_back();
+    categories_.pop_back();
+    cell_.pop_back();
+    slot_.pop_back();
+}
+
+void Dataset::clear() {
+    xs_.clear();
+    ys_.clear();
+    features_[0].clear();
+    features_[1].clear();
+    categories_.clear();
+    cell_.clear();
+    slot_.clear();
+    for (auto& list : cells_) {
+        list.clear();
+    }
+}
+
+void Dataset::resize(sf::Vector2u window_size) {
+    if (window_size == windowSize_) {
+        return;
+    }
+    windowSize_ = window_size;
+    for (size_t i = 0; i != size(); ++i) {
+        features_[0][i] = 2 * xs_[i] / windowSize_.x - 1;
+        features_[1][i] = 2 * ys_[i] / windowSize_.y - 1;
+    }
+    buildGrid();
+}
+
+std::vector<size_t> Dataset::within(sf::Vector2f pos, float radius) const {
+    std::vector<size_t> result;
+    const uint32_t left = clampCell(pos.x - radius, columns_),
+                   right = clampCell(pos.x + radius, columns_),
+                   top = clampCell(pos.y - radius, rows_),
+                   bottom = clampCell(pos.y + radius, rows_);
+    auto sq = [](float x) { return x * x; };
+    for (uint32_t row = top; row <= bottom; ++row) {
+        for (uint32_t column = left; column <= right; ++column) {
+            for (uint32_t i : cells_[row * columns_ + column]) {
+                if (sq(radius) > sq(xs_[i] - pos.x) + sq(ys_[i] - pos.y)) {
+                    result.push_back(i);
+                }
+            }
+        }
+    }
+    std::sort(result.begin(), result.end(), std::greater<size_t>());
+    return result;
+}
+
+uint32_t Dataset::clampCell(float v, uint32_t n) const {
+    return static_cast<uint32_t>(
+        std::min(std::max(v / cellSize_, 0.0f), static_cast<float>(n - 1)));
+}
+
+uint32_t Dataset::cellOf(float x, float y) const {
+    return clampCell(y, rows_) * columns_ + clampCell(x, columns_);
+}
+
+void Dataset::buildGrid() {
+    columns_ = std::max(
+        1u, static_cast<uint32_t>(std::ceil(windowSize_.x / cellSize_)));
+    rows_ = std::max(
+        1u, static_cast<uint32_t>(std::ceil(windowSize_.y / cellSize_)));
+    cells_.assign(static_cast<size_t>(columns_) * rows_, {});
+    for (uint32_t i = 0; i != size(); ++i) {
+        const uint32_t cell = cellOf(xs_[i], ys_[i]);
+        cell_[i] = cell;
+        slot_[i] = static_cast<uint32_t>(cells_[cell].size());
+        cells_[cell].push_back(i);
+    }
+}
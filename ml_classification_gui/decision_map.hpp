@@ -0,0 +1,69 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "../common/worker_pool.hpp"
+
+// The regions of any classifier as a texture of the window. render()
+// predicts the corners of kTile x kTile tiles and fills the tiles whose
+// corners agree at once; only tiles the boundary passes through are
+// predicted pixel by pixel, so a region smaller than a tile that covers
+// none of its corners is missed. Tiles are spread over a worker pool, and
+// the pixels and texture are kept between renders; the caller renders again
+// only when the classifier or the window size changed.
+class DecisionMap {
+   public:
+    static constexpr unsigned kTile = 16;
+
+    explicit DecisionMap(
+        unsigned threads = std::thread::hardware_concurrency())
+        : pool_(threads) {}
+    // predict(sf::Vector2u) returns 1 or -1 and is called from every worker
+    template <typename Predict>
+    void render(sf::Vector2u size, const Predict& predict);
+    void draw(sf::RenderTarget& target) const { target.draw(sprite_); }
+
+   private:
+    WorkerPool pool_;
+    std::vector<sf::Color> pixels_;  // RGBA, as the texture wants them
+    sf::Texture texture_;
+    sf::Sprite sprite_;
+};
+
+template <typename Predict>
+void DecisionMap::render(sf::Vector2u size, const Predict& predict) {
+    if (texture_.getSize() != size) {
+        texture_.create(size.x, size.y);
+        sprite_.setTexture(texture_, true);
+        pixels_.resize(static_cast<size_t>(size.x) * size.y);
+    }
+    const unsigned tiles_x = (size.x + kTile - 1) / kTile,
+                   tiles = tiles_x * ((size.y + kTile - 1) / kTile);
+    std::atomic<unsigned> next{0};
+    pool_.run([&](unsigned) {
+        for (unsigned tile; (tile = next.fetch_add(1)) < tiles;) {
+            const unsigned x0 = tile % tiles_x * kTile,
+                           y0 = tile / tiles_x * kTile,
+                           x1 = std::min(x0 + kTile, size.x) - 1,
+                           y1 = std::min(y0 + kTile, size.y) - 1;
+            const int category = predict({x0, y0});
+            const bool uniform = predict({x1, y0}) == category &&
+                                 predict({x0, y1}) == category &&
+                                 predict({x1, y1}) == category;
+            for (uint32_t y = y0; y <= y1; ++y) {
+                sf::Color* row = &pixels_[static_cast<size_t>(y) * size.x];
+                for (uint32_t x = x0; x <= x1; ++x) {
+                    row[x] = (uniform ? category : predict({x, y})) == 1
+                                 ? sf::Color::Magenta
+                                 : sf::Color::Cyan;
+                }
+            }
+        }
+    });
+    texture_.update(reinterpret_cast<const sf::Uint8*>(pixels_.data()));
+}
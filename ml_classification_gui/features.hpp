@@ -0,0 +1,16 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+// The features of sample i of a dataset held as one array per feature.
+template <size_t kFeatures>
+std::array<float, kFeatures> sampleAt(
+    const std::array<std::vector<float>, kFeatures>& x, size_t i) {
+    std::array<float, kFeatures> result;
+    for (size_t j = 0; j != kFeatures; ++j) {
+        result[j] = x[j][i];
+    }
+    return result;
+}
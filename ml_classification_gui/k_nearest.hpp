@@ -0,0 +1,85 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "features.hpp"
+
+// k-nearest neighbours: predicts the majority label of the k training
+// samples closest to x. fit() only keeps the samples, so the boundary is
+// no line and the classification task rasterizes it; getVersion() changes
+// whenever the samples do, so the picture is only redrawn then.
+template <size_t kFeatures>
+class KNearest {
+   public:
+    static constexpr size_t kMaxK = 15;
+
+    // eta is unused, the task makes every classifier from a learning rate
+    KNearest(float eta = 0.01f, size_t k = 5);
+    void initialize();
+    void fit(const std::array<std::vector<float>, kFeatures>& x,
+             const std::vector<int>& y, uint32_t n_iter = 1);
+    int predict(const std::array<float, kFeatures>& x) const;
+    uint64_t getVersion() const { return version_; }
+
+   private:
+    std::array<std::vector<float>, kFeatures> x_;
+    std::vector<int> y_;
+    size_t k_;
+    uint64_t version_ = 0;
+};
+
+template <size_t kFeatures>
+KNearest<kFeatures>::KNearest(float, size_t k)
+    : k_(std::min(std::max(k, size_t(1)), kMaxK)) {}
+
+template <size_t kFeatures>
+void KNearest<kFeatures>::initialize() {
+    for (auto& feature : x_) {
+        feature.clear();
+    }
+    y_.clear();
+    ++version_;
+}
+
+template <size_t kFeatures>
+void KNearest<kFeatures>::fit(
+    const std::array<std::vector<float>, kFeatures>& x,
+    const std::vector<int>& y, uint32_t) {
+    if (x == x_ && y == y_) {
+        return;
+    }
+    x_ = x;
+    y_ = y;
+    ++version_;
+}
+
+template <size_t kFeatures>
+int KNearest<kFeatures>::predict(
+    const std::array<float, kFeatures>& x) const {
+    // the nearest samples so far as (squared distance, label), ascending
+    std::array<std::pair<float, int>, kMaxK> nearest;
+    const size_t k = std::min(k_, y_.size());
+    size_t found = 0;
+    for (size_t i = 0; i != y_.size(); ++i) {
+        float distance = 0;
+        for (size_t j = 0; j != kFeatures; ++j) {
+            const float d = x_[j][i] - x[j];
+            distance += d * d;
+        }
+        if (found == k && distance >= nearest[k - 1].first) {
+            continue;
+        }
+        size_t slot = found < k ? found++ : k - 1;
+        for (; slot != 0 && nearest[slot - 1].first > distance; --slot) {
+            nearest[slot] = nearest[slot - 1];
+        }
+        nearest[slot] = {distance, y_[i]};
+    }
+    int votes = 0;
+    for (size_t i = 0; i != found; ++i) {
+        votes += nearest[i].second;
+    }
+    return votes > 0 ? 1 : -1;
+}
@@ -2,16 +2,21 @@
 #include <random>
 #include <vector>
 
+#include "features.hpp"
+
 // Rosenblatt's perceptron
 template <size_t kFeatures>
 class Perceptron {
    public:
     Perceptron(float eta = 0.01f, uint32_t random_state = 0);
     void initialize();
-    void fit(const std::vector<std::array<float, kFeatures>>& x,
+    void fit(const std::array<std::vector<float>, kFeatures>& x,
              const std::vector<int>& y, uint32_t n_iter = 1);
     int predict(const std::array<float, kFeatures>& x) const;
     const std::vector<float>& getLosses() const { return errors_; }
+    // one weight per feature, then the bias
+    const std::array<float, kFeatures + 1>& getWeights() const { return w_; }
+    void setWeights(const std::array<float, kFeatures + 1>& w) { w_ = w; }
 
    private:
     std::array<float, kFeatures + 1> w_;
@@ -39,15 +44,16 @@ void Perceptron<kFeatures>::initialize() {
 
 template <size_t kFeatures>
 void Perceptron<kFeatures>::fit(
-    const std::vector<std::array<float, kFeatures>>& x,
+    const std::array<std::vector<float>, kFeatures>& x,
     const std::vector<int>& y, uint32_t n_iter) {
     for (uint32_t n = 0; n < n_iter; ++n) {
-        for (size_t i = 0; i != x.size(); ++i) {
-            int delta = y[i] - predict(x[i]);
+        for (size_t i = 0; i != y.size(); ++i) {
+            const std::array<float, kFeatures> x_i = sampleAt(x, i);
+            int delta = y[i] - predict(x_i);
             errors_.push_back(static_cast<bool>(delta));
             float update = eta * static_cast<float>(delta);
             for (size_t j = 0; j != kFeatures; ++j) {
-                w_[j] += update * x[i][j];
+                w_[j] += update * x_i[j];
             }
             w_[kFeatures] += update;
         }
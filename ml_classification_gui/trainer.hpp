@@ -0,0 +1,311 @@
+#pragma once
+
+#include <SFML/Graphics.hpp>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "../common/profiler.hpp"
+#include "dataset.hpp"
+
+// Sequence lock for one writer: load() copies the value without taking a
+// lock and retries only if a store() overlapped the copy.
+template <typename T>
+class Seqlock {
+   public:
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "Seqlock copies values as raw words");
+
+    void store(const T& value);
+    T load() const;
+
+   private:
+    static constexpr size_t kWords =
+        (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    std::atomic<uint64_t> sequence_{0};  // odd while a store is in progress
+    std::atomic<uint64_t> words_[kWords]{};
+};
+
+// Classifiers whose whole state is a trivially copyable value that
+// getWeights() returns and setWeights() takes back
+template <typename C, typename = void>
+struct HasWeights : std::false_type {};
+
+template <typename C>
+struct HasWeights<C, std::void_t<decltype(std::declval<C&>().setWeights(
+                         std::declval<const C&>().getWeights()))>>
+    : std::is_trivially_copyable<
+          std::decay_t<decltype(std::declval<const C&>().getWeights())>> {};
+
+// Hands a classifier from the thread that fits it to one that predicts with
+// it. Classifiers with weights publish only those, through a seqlock. Any
+// other classifier is published as a whole copy behind a shared_ptr that is
+// swapped atomically; if it has getVersion(), only when that changed.
+template <typename Classifier, bool = HasWeights<Classifier>::value>
+class Publisher {
+   public:
+    void publish(const Classifier& classifier);
+    // brings view up to date, true if it changed; one reader only
+    bool refresh(Classifier& view);
+
+   private:
+    std::shared_ptr<const Classifier> latest_;
+    std::shared_ptr<const Classifier> seen_;  // reader only
+    uint64_t version_ = 0;                    // writer only
+
+    template <typename C>
+    auto changed(const C& classifier, int)
+        -> decltype(classifier.getVersion(), bool());
+    template <typename C>
+    bool changed(const C&, long) {
+        return true;
+    }
+};
+
+template <typename Classifier>
+class Publisher<Classifier, true> {
+   public:
+    using Weights = std::decay_t<
+        decltype(std::declval<const Classifier&>().getWeights())>;
+
+    void publish(const Classifier& classifier) {
+        weights_.store(classifier.getWeights());
+    }
+    bool refresh(Classifier& view);
+
+   private:
+    Seqlock<Weights> weights_;
+};
+
+// Fits a classifier on a thread of its own. The points live on that thread
+// too, in a Dataset of their own: add(), remove(), clear() and resize()
+// only queue the change, and train() only grants more eras, so none of them
+// waits for a fit to finish. Applying the same calls to another Dataset
+// keeps its indices the same as the trainer's. After every batch of eras
+// the classifier is published for refresh() to pick up.
+template <typename Classifier>
+class Trainer {
+   public:
+    Trainer(float learning_rate, sf::Vector2u window_size);
+    ~Trainer();
+    Trainer(const Trainer&) = delete;
+    Trainer& operator=(const Trainer&) = delete;
+
+    void add(sf::Vector2f pos, int y);
+    void remove(size_t index);
+    void clear();
+    void resize(sf::Vector2u window_size);
+    // Grants eras more eras. At most two grants are kept, so a trainer
+    // slower than the caller simply fits without pause.
+    void train(uint32_t eras);
+    // copies the last published classifier into view, true if it changed;
+    // call it from one thread only
+    bool refresh(Classifier& view) { return published_.refresh(view); }
+
+   private:
+    struct Edit {
+        enum Type { kAdd, kRemove, kClear, kResize } type;
+        sf::Vector2f pos;
+        int y;
+        size_t index;
+        sf::Vector2u size;
+    };
+
+    Classifier classifier_;
+    Publisher<Classifier> published_;
+    Dataset points_;  // trainer thread only
+    std::mutex mutex_;  // guards the members below
+    std::condition_variable wake_;
+    std::vector<Edit> edits_;
+    uint32_t eras_ = 0;
+    bool stopping_ = false;
+    std::thread thread_;
+
+    void post(const Edit& edit);
+    void run();
+};
+
+template <typename T>
+void Seqlock<T>::store(const T& value) {
+    uint64_t words[kWords] = {};
+    std::memcpy(words, &value, sizeof(T));
+    const uint64_t sequence = sequence_.load(std::memory_order_relaxed);
+    sequence_.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t k = 0; k != kWords; ++k) {
+        words_[k].store(words[k], std::memory_order_relaxed);
+    }
+    sequence_.store(sequence + 2, std::memory_order_release);
+}
+
+template <typename T>
+T Seqlock<T>::load() const {
+    uint64_t words[kWords];
+    uint64_t before, after;
+    do {
+        before = sequence_.load(std::memory_order_acquire);
+        for (size_t k = 0; k != kWords; ++k) {
+            words[k] = words_[k].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = sequence_.load(std::memory_order_relaxed);
+    } while (before != after || (before & 1));
+    T value;
+    std::memcpy(&value, words, sizeof(T));
+    return value;
+}
+
+template <typename Classifier, bool kWeights>
+void Publisher<Classifier, kWeights>::publish(const Classifier& classifier) {
+    if (!changed(classifier, 0) && latest_) {
+        return;
+    }
+    std::atomic_store(&latest_, std::shared_ptr<const Classifier>(
+                                    new Classifier(classifier)));
+}
+
+template <typename Classifier, bool kWeights>
+bool Publisher<Classifier, kWeights>::refresh(Classifier& view) {
+    std::shared_ptr<const Classifier> latest = std::atomic_load(&latest_);
+    if (!latest || latest == seen_) {
+        return false;
+    }
+    view = *latest;
+    seen_ = std::move(latest);
+    return true;
+}
+
+template <typename Classifier, bool kWeights>
+template <typename C>
+auto Publisher<Classifier, kWeights>::changed(const C& classifier, int)
+    -> decltype(classifier.getVersion(), bool()) {
+    const uint64_t version = classifier.getVersion();
+    if (version == version_) {
+        return false;
+    }
+    version_ = version;
+    return true;
+}
+
+template <typename Classifier>
+bool Publisher<Classifier, true>::refresh(Classifier& view) {
+    const Weights weights = weights_.load();
+    if (weights == view.getWeights()) {
+        return false;
+    }
+    view.setWeights(weights);
+    return true;
+}
+
+template <typename Classifier>
+Trainer<Classifier>::Trainer(float learning_rate, sf::Vector2u window_size)
+    : classifier_(learning_rate),
+      // a single cell, the trainer never looks points up
+      points_(window_size,
+              static_cast<float>(std::max(window_size.x, window_size.y))) {
+    published_.publish(classifier_);
+    thread_ = std::thread(&Trainer::run, this);
+}
+
+template <typename Classifier>
+Trainer<Classifier>::~Trainer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+}
+
+template <typename Classifier>
+void Trainer<Classifier>::add(sf::Vector2f pos, int y) {
+    post({Edit::kAdd, pos, y, 0, {}});
+}
+
+template <typename Classifier>
+void Trainer<Classifier>::remove(size_t index) {
+    post({Edit::kRemove, {}, 0, index, {}});
+}
+
+template <typename Classifier>
+void Trainer<Classifier>::clear() {
+    post({Edit::kClear, {}, 0, 0, {}});
+}
+
+template <typename Classifier>
+void Trainer<Classifier>::resize(sf::Vector2u window_size) {
+    post({Edit::kResize, {}, 0, 0, window_size});
+}
+
+template <typename Classifier>
+void Trainer<Classifier>::train(uint32_t eras) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        eras_ = std::min(eras_ + eras, 2 * eras);
+    }
+    wake_.notify_one();
+}
+
+template <typename Classifier>
+void Trainer<Classifier>::post(const Edit& edit) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        edits_.push_back(edit);
+    }
+    wake_.notify_one();
+}
+
+template <typename Classifier>
+void Trainer<Classifier>::run() {
+    Profiler::get().name_thread("trainer");
+    std::vector<Edit> edits;
+    while (true) {
+        uint32_t eras;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [this] {
+                return stopping_ || !edits_.empty() || eras_ != 0;
+            });
+            if (stopping_) {
+                return;
+            }
+            edits.swap(edits_);
+            eras = eras_;
+            eras_ = 0;
+        }
+        for (const Edit& edit : edits) {
+            switch (edit.type) {
+                case Edit::kAdd:
+                    points_.add(edit.pos, edit.y);
+                    break;
+                case Edit::kRemove:
+                    points_.remove(edit.index);
+                    break;
+                case Edit::kClear:
+                    points_.clear();
+                    classifier_.initialize();
+                    break;
+                case Edit::kResize:
+                    points_.resize(edit.size);
+                    break;
+            }
+        }
+        edits.clear();
+        if (points_.size() != 0 && eras != 0) {
+            ProfileScope scope("Classifier::fit");
+            classifier_.fit(points_.getFeatures(), points_.getCategories(),
+                            eras);
+        }
+        published_.publish(classifier_);
+    }
+}